@@ -1,17 +1,68 @@
 #include <fmt/color.h>
 #include <lex/lexer.hpp>
-#include <utils/storage.hpp>
+#include <lex/mapped_file.hpp>
+#include <lex/token_stream.hpp>
+#include <types/type_context.hpp>
+#include <utils/thread_pool.hpp>
 
 #include <parse/parser.hpp>
 #include <ast/expressions.hpp>
 #include <ast/declarations.hpp>
 
+#include <ast/binary_ast.hpp>
+#include <ast/visitors/flat_tree_builder.hpp>
 #include <ast/visitors/print_visitor.hpp>
+#include <ast/visitors/fused_visitor.hpp>
 #include <passes/symbol_table_builder.hpp>
 #include <passes/definition_checker.hpp>
 #include <passes/type_evaluator.hpp>
+#include <passes/parallel_analyzer.hpp>
 
+#include <cstdlib>
+#include <filesystem>
 #include <fstream>
+#include <memory>
+#include <optional>
+
+#include <unistd.h>
+
+// Inputs at least this big are lexed up front into a TokenStream
+static constexpr size_t kPreLexThreshold = 64 * 1024;
+
+// ... and at least this big are lexed on all cores
+static constexpr size_t kParallelLexThreshold = 4 * 1024 * 1024;
+
+// Directory to cache parsed files in, no caching if unset
+static constexpr const char* kCacheDirVariable = "LTC_CACHE_DIR";
+
+// Keyed by the source text and the compiler, so stale entries are never hit
+static std::string CachePath(const char* dir, std::string_view text) {
+  return fmt::format("{}/{:016x}-{}-{}.ast", dir, utils::HashBytes(text), LTC_VERSION,
+                     ast::BinaryAst::kFormatVersion);
+}
+
+// The cache is best effort, a failed write is not an error
+static void StoreCached(const std::string& path, ast::Program* prg, const lex::IdentTable& idents) {
+  ast::FlatTreeBuilder builder;
+  prg->Accept(&builder);
+  std::string data = ast::BinaryAst::Write(builder.TakeTree(), idents);
+
+  // Readers must never see a partial file
+  std::string temp_path = fmt::format("{}.{}.tmp", path, ::getpid());
+  {
+    std::ofstream out(temp_path, std::ios::binary);
+    out.write(data.data(), static_cast<std::streamsize>(data.size()));
+    if (!out) {
+      return;
+    }
+  }
+
+  std::error_code error;
+  std::filesystem::rename(temp_path, path, error);
+  if (error) {
+    std::filesystem::remove(temp_path, error);
+  }
+}
 
 int main(int argc, const char* argv[]) {
   if (argc < 2) {
@@ -19,23 +70,76 @@ int main(int argc, const char* argv[]) {
     return 0;
   }
 
-  std::ifstream program(argv[1]);
+  // Map regular files directly, fall back to reading the stream for
+  // pipes and the like
+  std::optional<lex::MappedFile> mapped = lex::MappedFile::Open(argv[1]);
+  size_t size = mapped.has_value() ? mapped->GetView().size() : 0;
+
+  lex::IdentTable idents;
+  lex::SourceTable sources(idents);
+  std::ifstream program;
+  std::unique_ptr<lex::SourceFile> source;
+  std::unique_ptr<lex::Lexer> lexer;
+  std::unique_ptr<lex::TokenStream> tokens;
+
+  types::TypeContext type_keeper;
+
+  ast::Arena arena;
+  ast::Program* prg = nullptr;
 
-  lex::Lexer lexer(program);
-  utils::Storage<types::Type> type_keeper;
+  std::string cache_path;
+  if (const char* cache_dir = std::getenv(kCacheDirVariable); cache_dir && mapped.has_value()) {
+    cache_path = CachePath(cache_dir, mapped->GetView());
 
-  parse::Parser parser(lexer, type_keeper);
-  ast::Program* prg = parser.ParseProgram();
+    if (auto cached = lex::MappedFile::Open(cache_path.c_str())) {
+      source = std::make_unique<lex::SourceFile>(mapped->GetView(), sources);
+      auto tree = ast::BinaryAst::Read(cached->GetView(), *source, type_keeper);
+      if (tree.has_value()) {
+        prg = tree->ToProgram(arena);
+      }
+    }
+  }
 
-  passes::SymbolTableBuilder gen;
-  prg->Accept(&gen);
+  utils::ThreadPool pool;
+  if (prg != nullptr) {
+    // Loaded from the cache
+  } else if (size >= kParallelLexThreshold && pool.Size() > 1) {
+    source = std::make_unique<lex::SourceFile>(mapped->GetView(), sources);
+    tokens = std::make_unique<lex::TokenStream>(*source, pool);
+  } else if (mapped.has_value()) {
+    lexer = std::make_unique<lex::Lexer>(mapped->GetView(), sources);
+    if (size >= kPreLexThreshold) {
+      tokens = std::make_unique<lex::TokenStream>(*lexer);
+    }
+  } else {
+    // Streamed, must stay open while the lexer runs
+    program.open(argv[1]);
+    lexer = std::make_unique<lex::Lexer>(program, sources);
+  }
 
-  passes::DefinitionChecker checker;
-  prg->Accept(&checker);
+  if (prg == nullptr) {
+    parse::Parser parser = tokens != nullptr ? parse::Parser(*tokens, type_keeper, arena)
+                                             : parse::Parser(*lexer, type_keeper, arena);
+    prg = tokens != nullptr && pool.Size() > 1 ? parser.ParseProgram(pool)
+                                               : parser.ParseProgram();
 
-  passes::TypeEvaluator type_evaluator;
-  prg->Accept(&type_evaluator);
+    if (!cache_path.empty()) {
+      StoreCached(cache_path, prg, idents);
+    }
+  }
+
+  // Semantic analysis in a single walk, or one per declaration on the pool
+  if (pool.Size() > 1) {
+    passes::ParallelAnalyzer analyzer(arena, sources, pool);
+    analyzer.Analyze(prg);
+  } else {
+    passes::SymbolTableBuilder gen(arena, sources);
+    passes::DefinitionChecker checker(sources);
+    passes::TypeEvaluator type_evaluator(sources);
+    ast::FusedVisitor analysis(gen, checker, type_evaluator);
+    prg->Accept(&analysis);
+  }
 
-  ast::PrintVisitor serializer;
+  ast::PrintVisitor serializer(sources);
   prg->Accept(&serializer);
 }
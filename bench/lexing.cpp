@@ -0,0 +1,98 @@
+// Lexing throughput of a generated multi-megabyte program: the serial
+// lexer against the chunked parallel one at 1..N threads. Build with
+// -DCMAKE_BUILD_TYPE=Release
+//
+//   lexing_bench [megabytes] [rounds] [max threads]
+
+#include <lex/lexer.hpp>
+#include <lex/token_stream.hpp>
+#include <utils/thread_pool.hpp>
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+//////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// Multi-line strings and comments keep the chunk joins honest: a split
+// point may well land inside one of them
+std::string GenerateProgram(size_t bytes) {
+  std::string program = "of Int var seed = 42;\n";
+  for (size_t i = 0; program.size() < bytes; i++) {
+    program += fmt::format(
+        "# f{0} mixes a bit of everything\n"
+        "of [Int, Int] -> Int fun f{0}(x, y) = {{\n"
+        "    of Int var a = x * {0} + y - (x + 1) * (y - 2);\n"
+        "    of *String var s = \"line one of f{0}\n# still the string\";\n"
+        "    a = if a > seed then {{ -a + x * y; }} else {{ a - {0}; }};\n"
+        "    return if a == 0 then f{0}(x - 1, a + y) else a + seed;\n"
+        "}};\n", i);
+  }
+  return program;
+}
+
+// Best of `rounds` runs of `fn`, in milliseconds
+template <typename Func>
+double Measure(size_t rounds, Func fn) {
+  double best = 1e300;
+  for (size_t i = 0; i < rounds; i++) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    best = std::min(best, elapsed.count());
+  }
+  return best;
+}
+
+}  // namespace
+
+//////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv) {
+  size_t megabytes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 16;
+  size_t rounds = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 5;
+  size_t max_threads = argc > 3 ? std::strtoul(argv[3], nullptr, 10)
+                                : std::max(1u, std::thread::hardware_concurrency());
+
+  std::string source = GenerateProgram(megabytes << 20);
+  double size_mb = static_cast<double>(source.size()) / (1 << 20);
+
+  // Every round interns into a fresh table, as a real compilation would
+  size_t serial_tokens = 0;
+  double serial_ms = Measure(rounds, [&]() {
+    lex::IdentTable idents;
+    lex::SourceTable sources(idents);
+    lex::SourceFile file(source, sources);
+    lex::Lexer lexer(file, 0, idents);
+    lex::TokenStream stream(lexer);
+    serial_tokens = stream.Size();
+  });
+
+  fmt::print("{:.1f} MB of source, {} tokens\n", size_mb, serial_tokens);
+  fmt::print("{:<16}{:>10.2f} ms{:>10.1f} MB/s\n", "serial", serial_ms,
+             size_mb / serial_ms * 1000);
+
+  bool mismatch = false;
+  for (size_t threads = 1; threads <= max_threads; threads++) {
+    utils::ThreadPool pool(threads);
+    double parallel_ms = Measure(rounds, [&]() {
+      lex::IdentTable idents;
+      lex::SourceTable sources(idents);
+      lex::SourceFile file(source, sources);
+      lex::TokenStream stream(file, pool);
+      mismatch |= stream.Size() != serial_tokens;
+    });
+
+    fmt::print("{:<16}{:>10.2f} ms{:>10.1f} MB/s  ({:.2f}x)\n",
+               fmt::format("parallel, {}", threads), parallel_ms,
+               size_mb / parallel_ms * 1000, serial_ms / parallel_ms);
+  }
+
+  return mismatch ? 1 : 0;
+}
@@ -0,0 +1,156 @@
+// Times walks of a large generated program with virtual and statically
+// dispatched visitors. Build with -DCMAKE_BUILD_TYPE=Release, the
+// difference is in what the optimizer can inline
+//
+//   traversal_bench [functions] [rounds]
+
+#include <ast/visitors/base_visitor.hpp>
+#include <ast/visitors/fused_visitor.hpp>
+#include <ast/visitors/static_visitor.hpp>
+#include <lex/lexer.hpp>
+#include <parse/parser.hpp>
+#include <passes/definition_checker.hpp>
+#include <passes/parallel_analyzer.hpp>
+#include <passes/symbol_table_builder.hpp>
+#include <passes/type_evaluator.hpp>
+
+#include <fmt/core.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <string>
+
+//////////////////////////////////////////////////////////////////////
+
+namespace {
+
+std::string GenerateProgram(size_t functions) {
+  std::string program = "of Int var seed = 42;\n";
+  for (size_t i = 0; i < functions; i++) {
+    program += fmt::format(
+        "of [Int, Int] -> Int fun f{0}(x, y) = {{\n"
+        "    of Int var a = x * {0} + y - (x + 1) * (y - 2);\n"
+        "    of Bool var b = a > seed;\n"
+        "    a = if b then {{ -a + x * y; }} else {{ a - {0}; }};\n"
+        "    return if a == 0 then f{0}(x - 1, a + y) else a + seed;\n"
+        "}};\n", i);
+  }
+  return program;
+}
+
+// The same pass in both flavors: counts nodes
+struct VirtualCounter : ast::BaseVisitor {
+  void EnterLiteralExpression(ast::LiteralExpression*) override {
+    literals++;
+  }
+
+  void LeaveBinaryExpression(ast::BinaryExpression*) override {
+    operators++;
+  }
+
+  void LeaveComparisonExpression(ast::ComparisonExpression*) override {
+    operators++;
+  }
+
+  size_t literals = 0;
+  size_t operators = 0;
+};
+
+struct StaticCounter : ast::StaticVisitor<StaticCounter> {
+  void EnterLiteralExpression(ast::LiteralExpression*) {
+    literals++;
+  }
+
+  void LeaveBinaryExpression(ast::BinaryExpression*) {
+    operators++;
+  }
+
+  void LeaveComparisonExpression(ast::ComparisonExpression*) {
+    operators++;
+  }
+
+  size_t literals = 0;
+  size_t operators = 0;
+};
+
+// Best of `rounds` runs of `fn`, in milliseconds
+template <typename Func>
+double Measure(size_t rounds, Func fn) {
+  double best = 1e300;
+  for (size_t i = 0; i < rounds; i++) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    best = std::min(best, elapsed.count());
+  }
+  return best;
+}
+
+}  // namespace
+
+//////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv) {
+  size_t functions = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000;
+  size_t rounds = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 10;
+
+  std::string source = GenerateProgram(functions);
+  lex::Lexer lexer(source);
+  const lex::SourceTable& sources = lexer.GetSources();
+  types::TypeContext type_keeper;
+  ast::Arena arena;
+  parse::Parser parser(lexer, type_keeper, arena);
+  ast::Program* program = parser.ParseProgram();
+
+  size_t checksum = 0;
+  double virtual_ms = Measure(rounds, [&]() {
+    VirtualCounter counter;
+    program->Accept(&counter);
+    checksum += counter.literals + counter.operators;
+  });
+  double static_ms = Measure(rounds, [&]() {
+    StaticCounter counter;
+    program->Accept(&counter);
+    checksum -= counter.literals + counter.operators;
+  });
+
+  fmt::print("{} functions, {} bytes of source\n", functions, source.size());
+  fmt::print("{:<24}{:>10.2f} ms\n", "walk, virtual hooks", virtual_ms);
+  fmt::print("{:<24}{:>10.2f} ms  ({:.2f}x)\n", "walk, static hooks", static_ms,
+             virtual_ms / static_ms);
+
+  // The passes are static visitors, scopes are rebuilt on every round.
+  // The checks below need the scopes of a live builder
+  fmt::print("{:<24}{:>10.2f} ms\n", "symbol table", Measure(rounds, [&]() {
+    passes::SymbolTableBuilder builder(arena, sources);
+    program->Accept(&builder);
+  }));
+  passes::SymbolTableBuilder builder(arena, sources);
+  program->Accept(&builder);
+  fmt::print("{:<24}{:>10.2f} ms\n", "definition check", Measure(rounds, [&]() {
+    passes::DefinitionChecker checker(sources);
+    program->Accept(&checker);
+  }));
+  fmt::print("{:<24}{:>10.2f} ms\n", "type evaluation", Measure(rounds, [&]() {
+    passes::TypeEvaluator evaluator(sources);
+    program->Accept(&evaluator);
+  }));
+
+  // All three in a single walk
+  fmt::print("{:<24}{:>10.2f} ms\n", "fused analysis", Measure(rounds, [&]() {
+    passes::SymbolTableBuilder builder(arena, sources);
+    passes::DefinitionChecker checker(sources);
+    passes::TypeEvaluator evaluator(sources);
+    ast::FusedVisitor analysis(builder, checker, evaluator);
+    program->Accept(&analysis);
+  }));
+
+  // The same per top-level declaration, on every core
+  utils::ThreadPool pool;
+  fmt::print("{:<24}{:>10.2f} ms  ({} threads)\n", "parallel analysis", Measure(rounds, [&]() {
+    passes::ParallelAnalyzer analyzer(arena, sources, pool);
+    analyzer.Analyze(program);
+  }), pool.Size());
+
+  return checksum == 0 ? 0 : 1;
+}
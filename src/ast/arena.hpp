@@ -0,0 +1,114 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+//////////////////////////////////////////////////////////////////////
+
+namespace ast {
+
+// Bump allocator owning every node of a compilation. Memory comes from
+// slabs which are released all at once, destructors are never run, so
+// only trivially destructible types can be placed here. Nodes are laid
+// out in parse order, so a traversal walks memory mostly forward
+class Arena {
+ public:
+  static constexpr size_t kDefaultSlabSize = 64 * 1024;
+
+  explicit Arena(size_t slab_size = kDefaultSlabSize) : slab_size_(slab_size) {
+  }
+
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  // Nodes point into the slabs and each other, keep the arena in place
+  Arena(Arena&&) = delete;
+  Arena& operator=(Arena&&) = delete;
+
+  template <typename T, typename... Args>
+  T* New(Args&&... args) {
+    static_assert(std::is_trivially_destructible_v<T>,
+                  "Arena never runs destructors");
+    void* memory = Allocate(sizeof(T), alignof(T));
+    return new (memory) T(std::forward<Args>(args)...);
+  }
+
+  // Copies `items` next to the nodes, for child lists
+  template <typename T>
+  std::span<T> NewArray(const std::vector<T>& items) {
+    static_assert(std::is_trivially_destructible_v<T>,
+                  "Arena never runs destructors");
+    if (items.empty()) {
+      return {};
+    }
+
+    auto* memory = static_cast<T*>(Allocate(sizeof(T) * items.size(), alignof(T)));
+    std::uninitialized_copy(items.begin(), items.end(), memory);
+    return {memory, items.size()};
+  }
+
+  void* Allocate(size_t size, size_t align) {
+    auto address = reinterpret_cast<uintptr_t>(cursor_);
+    size_t padding = (align - address % align) % align;
+
+    if (cursor_ == nullptr || padding + size > static_cast<size_t>(end_ - cursor_)) {
+      AddSlab(size + align);
+      address = reinterpret_cast<uintptr_t>(cursor_);
+      padding = (align - address % align) % align;
+    }
+
+    std::byte* result = cursor_ + padding;
+    cursor_ = result + size;
+    bytes_used_ += size;
+    return result;
+  }
+
+  // Takes over the slabs of `other`, which is left empty. Lets nodes
+  // built on another thread live as long as this arena
+  void Absorb(Arena& other) {
+    for (auto& slab : other.slabs_) {
+      slabs_.push_back(std::move(slab));
+    }
+    bytes_used_ += other.bytes_used_;
+
+    other.slabs_.clear();
+    other.cursor_ = other.end_ = nullptr;
+    other.bytes_used_ = 0;
+  }
+
+  size_t GetBytesUsed() const {
+    return bytes_used_;
+  }
+
+  size_t GetSlabCount() const {
+    return slabs_.size();
+  }
+
+ private:
+  void AddSlab(size_t min_size) {
+    // Oversized requests get a slab of their own
+    size_t size = std::max(slab_size_, min_size);
+    slabs_.push_back(std::make_unique_for_overwrite<std::byte[]>(size));
+    cursor_ = slabs_.back().get();
+    end_ = cursor_ + size;
+  }
+
+ private:
+  size_t slab_size_;
+  std::vector<std::unique_ptr<std::byte[]>> slabs_;
+
+  std::byte* cursor_ = nullptr;
+  std::byte* end_ = nullptr;
+  size_t bytes_used_ = 0;
+};
+
+}  // namespace ast
+
+//////////////////////////////////////////////////////////////////////
@@ -0,0 +1,503 @@
+#pragma once
+
+#include <ast/flat_tree.hpp>
+#include <lex/ident_table.hpp>
+#include <lex/source_file.hpp>
+#include <types/primitive_types.hpp>
+#include <types/type_context.hpp>
+#include <utils/casting.hpp>
+#include <utils/varint.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+//////////////////////////////////////////////////////////////////////
+
+namespace ast {
+
+// Compact on-disk form of a FlatTree, for caching parsed files. Numbers
+// are varints, kinds and token types are raw byte columns, so a mapped
+// file is decoded in a single forward sweep. Layout:
+//
+//   magic, format version
+//   identifier names, in SymbolId order
+//   type table, operands refer to earlier entries, entry 0 is null
+//   declared types, as type table entries
+//   node columns, offsets as deltas from the previous node, operands
+//   as deltas from the node
+//   lists, items as deltas from the previous one
+//   FNV-1a of everything above, 8 bytes
+//
+// Identifiers are interned anew on reading, string tokens still point
+// into the source text, which must be the one the tree was parsed from
+struct BinaryAst {
+  static constexpr std::string_view kMagic = "LTAST";
+  static constexpr uint64_t kFormatVersion = 1;
+
+  static std::string Write(const FlatTree& tree, const lex::IdentTable& idents) {
+    std::string out(kMagic);
+    utils::WriteVarint(out, kFormatVersion);
+
+    utils::WriteVarint(out, idents.Size());
+    for (lex::SymbolId id = 0; id < idents.Size(); id++) {
+      std::string_view name = idents.GetName(id);
+      utils::WriteVarint(out, name.size());
+      out += name;
+    }
+
+    WriteTypes(out, tree);
+
+    size_t count = tree.Size();
+    utils::WriteVarint(out, count);
+    out.append(reinterpret_cast<const char*>(tree.kinds_.data()), count);
+    out.append(reinterpret_cast<const char*>(tree.token_types_.data()), count);
+
+    uint32_t prev_offset = 0;
+    for (uint32_t offset : tree.offsets_) {
+      utils::WriteSignedVarint(out, int64_t{offset} - int64_t{prev_offset});
+      prev_offset = offset;
+    }
+
+    for (uint32_t payload : tree.payloads_) {
+      utils::WriteVarint(out, payload);
+    }
+
+    for (NodeId id = 0; id < count; id++) {
+      WriteOperand(out, tree.lhs_[id], id);
+    }
+    for (NodeId id = 0; id < count; id++) {
+      WriteOperand(out, tree.rhs_[id], id);
+    }
+
+    utils::WriteVarint(out, tree.lists_.size());
+    uint32_t prev_item = 0;
+    for (uint32_t item : tree.lists_) {
+      WriteOperand(out, item, prev_item);
+      prev_item = item == kNoNode ? prev_item : item;
+    }
+
+    uint64_t checksum = utils::HashBytes(out);
+    out.append(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+    return out;
+  }
+
+  // The tree of Write(), its identifiers interned into the table of
+  // `source` and its tokens pointing to `source`. Nullopt if `data` is not a tree of
+  // this format version or is damaged. Beyond the checksum, the tree is
+  // checked to be one ToProgram can rebuild, so a bad file is a cache
+  // miss rather than a crash
+  static std::optional<FlatTree> Read(std::string_view data, lex::SourceFile& source,
+                                      types::TypeContext& type_keeper) {
+    uint64_t checksum = 0;
+    if (data.size() < kMagic.size() + sizeof(checksum)) {
+      return std::nullopt;
+    }
+
+    std::memcpy(&checksum, data.data() + data.size() - sizeof(checksum), sizeof(checksum));
+    data.remove_suffix(sizeof(checksum));
+    if (!data.starts_with(kMagic) || utils::HashBytes(data) != checksum) {
+      return std::nullopt;
+    }
+
+    utils::VarintReader in(data.substr(kMagic.size()));
+    if (in.ReadVarint() != kFormatVersion) {
+      return std::nullopt;
+    }
+
+    std::vector<lex::SymbolId> remap(in.ReadCount());
+    for (auto& id : remap) {
+      id = source.GetIdents().Intern(in.ReadBytes(in.ReadVarint()));
+    }
+
+    auto type_table = ReadTypes(in, type_keeper);
+    if (!type_table.has_value()) {
+      return std::nullopt;
+    }
+
+    FlatTree tree;
+    tree.source_id_ = source.GetId();
+
+    tree.types_.resize(in.ReadCount());
+    for (auto& type : tree.types_) {
+      uint64_t index = in.ReadVarint();
+      if (index >= type_table->size()) {
+        return std::nullopt;
+      }
+      type = (*type_table)[index];
+    }
+
+    size_t count = in.ReadCount();
+    std::string_view kinds = in.ReadBytes(count);
+    std::string_view token_types = in.ReadBytes(count);
+    // A tree holds its Program node at least
+    if (!in.Ok() || count == 0) {
+      return std::nullopt;
+    }
+
+    tree.kinds_.resize(count);
+    std::memcpy(tree.kinds_.data(), kinds.data(), count);
+    tree.token_types_.resize(count);
+    std::memcpy(tree.token_types_.data(), token_types.data(), count);
+
+    tree.offsets_.resize(count);
+    uint32_t offset = 0;
+    for (auto& item : tree.offsets_) {
+      offset += static_cast<uint32_t>(in.ReadSignedVarint());
+      item = offset;
+    }
+
+    // Tokens must decode within the text they point to
+    uint64_t text_size = UINT32_MAX;
+    if (!source.IsStreamed()) {
+      text_size = source.GetText().size();
+    }
+
+    tree.payloads_.resize(count);
+    for (size_t i = 0; i < count; i++) {
+      uint64_t payload = in.ReadVarint();
+      if (tree.offsets_[i] > text_size) {
+        return std::nullopt;
+      }
+
+      if (tree.token_types_[i] == lex::TokenType::IDENTIFIER) {
+        if (payload >= remap.size()) {
+          return std::nullopt;
+        }
+        payload = remap[payload];
+      } else if (tree.token_types_[i] == lex::TokenType::STRING &&
+                 payload > text_size - tree.offsets_[i]) {
+        return std::nullopt;
+      }
+      tree.payloads_[i] = static_cast<uint32_t>(payload);
+    }
+
+    tree.lhs_.resize(count);
+    for (NodeId id = 0; id < count; id++) {
+      tree.lhs_[id] = ReadOperand(in, id);
+    }
+    tree.rhs_.resize(count);
+    for (NodeId id = 0; id < count; id++) {
+      tree.rhs_[id] = ReadOperand(in, id);
+    }
+
+    tree.lists_.resize(in.ReadCount());
+    uint32_t prev_item = 0;
+    for (auto& item : tree.lists_) {
+      item = ReadOperand(in, prev_item);
+      prev_item = item == kNoNode ? prev_item : item;
+    }
+
+    if (!in.Ok() || !in.AtEnd() || !IsWellFormed(tree)) {
+      return std::nullopt;
+    }
+
+    return tree;
+  }
+
+ private:
+  // Operands mostly point a little after the node or the previous list
+  // item, so they are stored relative to that. 0 stands for kNoNode
+  static void WriteOperand(std::string& out, uint32_t operand, uint32_t base) {
+    if (operand == kNoNode) {
+      utils::WriteVarint(out, 0);
+    } else {
+      utils::WriteVarint(out, utils::ZigZagEncode(int64_t{operand} - int64_t{base}) + 1);
+    }
+  }
+
+  static uint32_t ReadOperand(utils::VarintReader& in, uint32_t base) {
+    uint64_t value = in.ReadVarint();
+    if (value == 0) {
+      return kNoNode;
+    }
+
+    return static_cast<uint32_t>(base + utils::ZigZagDecode(value - 1));
+  }
+
+  enum class TypeTag : uint8_t {
+    Null,
+    Int,
+    Bool,
+    String,
+    Unit,
+    Pointer,
+    Function,
+  };
+
+  static constexpr std::array<types::PrimitiveType*, 4> kPrimitives = {
+      &types::PrimitiveType::int_type,
+      &types::PrimitiveType::bool_type,
+      &types::PrimitiveType::string_type,
+      &types::PrimitiveType::unit_type,
+  };
+
+  // Table of the types declared in `tree`, then their entries in order
+  static void WriteTypes(std::string& out, const FlatTree& tree) {
+    std::string table;
+    std::unordered_map<types::Type*, uint64_t> index{{nullptr, 0}};
+    utils::WriteVarint(table, uint64_t(TypeTag::Null));
+
+    // Operands first, so reading never looks ahead
+    auto add = [&](auto& self, types::Type* type) -> uint64_t {
+      if (auto it = index.find(type); it != index.end()) {
+        return it->second;
+      }
+
+      std::string entry;
+      if (auto pointer = utils::dyn_cast<types::PointerType>(type)) {
+        uint64_t pointee = self(self, pointer->GetUnderlyingType());
+        utils::WriteVarint(entry, uint64_t(TypeTag::Pointer));
+        utils::WriteVarint(entry, pointee);
+      } else if (auto function = utils::dyn_cast<types::FunctionType>(type)) {
+        std::vector<uint64_t> operands{self(self, function->GetReturnType())};
+        for (types::Type* arg : function->GetArgTypes()) {
+          operands.push_back(self(self, arg));
+        }
+
+        utils::WriteVarint(entry, uint64_t(TypeTag::Function));
+        utils::WriteVarint(entry, operands.size() - 1);
+        for (uint64_t operand : operands) {
+          utils::WriteVarint(entry, operand);
+        }
+      } else {
+        auto primitive = std::find(kPrimitives.begin(), kPrimitives.end(), type);
+        FMT_ASSERT(primitive != kPrimitives.end(), "Unknown type\n");
+        utils::WriteVarint(entry, uint64_t(TypeTag::Int) + (primitive - kPrimitives.begin()));
+      }
+
+      table += entry;
+      uint64_t id = index.size();
+      index.emplace(type, id);
+      return id;
+    };
+
+    std::vector<uint64_t> declared;
+    for (types::Type* type : tree.types_) {
+      declared.push_back(add(add, type));
+    }
+
+    utils::WriteVarint(out, index.size());
+    out += table;
+
+    utils::WriteVarint(out, declared.size());
+    for (uint64_t id : declared) {
+      utils::WriteVarint(out, id);
+    }
+  }
+
+  // Nullopt on an unknown tag or an operand which is not an earlier,
+  // non-null entry
+  static std::optional<std::vector<types::Type*>> ReadTypes(utils::VarintReader& in,
+                                                            types::TypeContext& type_keeper) {
+    std::vector<types::Type*> table;
+    bool ok = true;
+    auto operand = [&]() -> types::Type* {
+      uint64_t id = in.ReadVarint();
+      if (id == 0 || id >= table.size()) {
+        ok = false;
+        return nullptr;
+      }
+      return table[id];
+    };
+
+    size_t size = in.ReadCount();
+    for (size_t i = 0; i < size && ok && in.Ok(); i++) {
+      auto tag = static_cast<TypeTag>(in.ReadVarint());
+      switch (tag) {
+        case TypeTag::Null:
+          // Only ever the first entry
+          ok = i == 0;
+          table.push_back(nullptr);
+          break;
+
+        case TypeTag::Int:
+        case TypeTag::Bool:
+        case TypeTag::String:
+        case TypeTag::Unit:
+          table.push_back(kPrimitives[size_t(tag) - size_t(TypeTag::Int)]);
+          break;
+
+        case TypeTag::Pointer: {
+          types::Type* pointee = operand();
+          table.push_back(ok ? type_keeper.GetPointerType(pointee) : nullptr);
+          break;
+        }
+
+        case TypeTag::Function: {
+          std::vector<types::Type*> args(in.ReadCount());
+          types::Type* return_type = operand();
+          for (auto& arg : args) {
+            arg = operand();
+          }
+
+          table.push_back(ok ? type_keeper.GetFunctionType(return_type, std::move(args)) : nullptr);
+          break;
+        }
+
+        default:
+          ok = false;
+          break;
+      }
+    }
+
+    if (!ok || !in.Ok()) {
+      return std::nullopt;
+    }
+    return table;
+  }
+
+  ////////////////////////////////////////////////////////////////////
+
+  static bool IsExpression(NodeKind kind) {
+    return kind >= NodeKind::Comparison && kind <= NodeKind::ErrorExpression;
+  }
+
+  static bool IsStatement(NodeKind kind) {
+    return kind >= NodeKind::VarDecl && kind <= NodeKind::ErrorStatement &&
+           kind != NodeKind::Param;
+  }
+
+  static bool IsDeclaration(NodeKind kind) {
+    return kind == NodeKind::VarDecl || kind == NodeKind::FunDecl ||
+           kind == NodeKind::ErrorStatement;
+  }
+
+  // Whether ToProgram can rebuild `tree`: kinds and token types are in
+  // range, operands, lists and types are inside their columns, and each
+  // operand is of the kind ToProgram expects there. Every node has at
+  // most one parent, which comes before it, so the rebuild terminates
+  // and stays linear in the size of the tree
+  static bool IsWellFormed(const FlatTree& tree) {
+    size_t count = tree.Size();
+    if (count == 0 || tree.kinds_[0] != NodeKind::Program) {
+      return false;
+    }
+
+    std::vector<bool> has_parent(count);
+    auto child = [&](NodeId parent, uint32_t id, auto accepts) {
+      if (id <= parent || id >= count || has_parent[id]) {
+        return false;
+      }
+
+      has_parent[id] = true;
+      return accepts(tree.kinds_[id]);
+    };
+
+    auto list = [&](uint32_t index) -> std::optional<std::span<const uint32_t>> {
+      if (index >= tree.lists_.size() || tree.lists_[index] >= tree.lists_.size() - index) {
+        return std::nullopt;
+      }
+      return tree.GetList(index);
+    };
+
+    auto children = [&](NodeId parent, uint32_t index, auto accepts) {
+      auto items = list(index);
+      return items.has_value() && std::all_of(items->begin(), items->end(), [&](uint32_t id) {
+               return child(parent, id, accepts);
+             });
+    };
+
+    auto type = [&](uint32_t index) -> types::Type* {
+      return index < tree.types_.size() ? tree.types_[index] : nullptr;
+    };
+
+    for (NodeId id = 0; id < count; id++) {
+      NodeKind kind = tree.kinds_[id];
+      lex::TokenType token = tree.token_types_[id];
+      uint32_t lhs = tree.lhs_[id];
+      uint32_t rhs = tree.rhs_[id];
+
+      if (kind > NodeKind::ErrorExpression || token > lex::TokenType::TOKEN_EOF) {
+        return false;
+      }
+
+      bool named = kind == NodeKind::VarDecl || kind == NodeKind::FunDecl ||
+                   kind == NodeKind::Param || kind == NodeKind::VarAccess;
+      if (named && token != lex::TokenType::IDENTIFIER) {
+        return false;
+      }
+
+      bool ok = true;
+      switch (kind) {
+        case NodeKind::Program:
+          ok = id == 0 && children(id, lhs, IsDeclaration);
+          break;
+
+        case NodeKind::VarDecl:
+          ok = child(id, lhs, IsExpression) && type(rhs) != nullptr;
+          break;
+
+        case NodeKind::FunDecl: {
+          auto items = list(rhs);
+          ok = items.has_value() && !items->empty() && child(id, lhs, IsExpression);
+          if (ok) {
+            types::Type* fun_type = type((*items)[0]);
+            ok = fun_type != nullptr && utils::isa<types::FunctionType>(fun_type);
+          }
+
+          for (size_t i = 1; ok && i < items->size(); i++) {
+            ok = child(id, (*items)[i], [](NodeKind param) {
+              return param == NodeKind::Param;
+            });
+          }
+          break;
+        }
+
+        case NodeKind::ExprStatement:
+        case NodeKind::Unary:
+        case NodeKind::Return:
+        case NodeKind::Yield:
+          ok = child(id, lhs, IsExpression);
+          break;
+
+        case NodeKind::Assignment:
+        case NodeKind::Comparison:
+        case NodeKind::Binary:
+          ok = child(id, lhs, IsExpression) && child(id, rhs, IsExpression);
+          break;
+
+        case NodeKind::FnCall:
+          ok = child(id, lhs, IsExpression) && children(id, rhs, IsExpression);
+          break;
+
+        case NodeKind::Block:
+          ok = children(id, lhs, IsStatement);
+          break;
+
+        case NodeKind::If: {
+          auto branches = list(rhs);
+          ok = child(id, lhs, IsExpression) && branches.has_value() && branches->size() == 2 &&
+               child(id, (*branches)[0], IsExpression) &&
+               ((*branches)[1] == kNoNode || child(id, (*branches)[1], IsExpression));
+          break;
+        }
+
+        case NodeKind::Literal:
+          ok = token == lex::TokenType::IDENTIFIER || token == lex::TokenType::NUMBER ||
+               token == lex::TokenType::STRING || token == lex::TokenType::TRUE ||
+               token == lex::TokenType::FALSE;
+          break;
+
+        default:
+          break;
+      }
+
+      if (!ok) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+};
+
+}  // namespace ast
+
+//////////////////////////////////////////////////////////////////////
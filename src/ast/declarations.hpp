@@ -4,39 +4,50 @@
 #include <lex/token.hpp>
 #include <types/type.hpp>
 
-#include <vector>
+#include <span>
 
 //////////////////////////////////////////////////////////////////////
 
 namespace ast {
 class Declaration : public ast::Statement {
  public:
+  using Statement::Statement;
+
+  static bool classof(const TreeNode* node) {
+    return node->GetKind() == NodeKind::VarDecl || node->GetKind() == NodeKind::FunDecl ||
+           node->GetKind() == NodeKind::ErrorStatement;
+  }
+
   void Accept(Visitor*) override {};
 
-  virtual std::string_view GetName() = 0;
+  virtual std::string_view GetName(const lex::SourceTable& sources) = 0;
 };
 
 class Program : public ast::TreeNode {
  public:
+  static constexpr NodeKind kKind = NodeKind::Program;
+
   void Accept(Visitor* visitor) override {
     visitor->VisitProgram(this);
   }
 
-  explicit Program(std::vector<Declaration*> decls)
-      : decls_{std::move(decls)} {
+  explicit Program(std::span<Declaration*> decls)
+      : TreeNode(kKind), decls_{decls} {
   }
 
   lex::Location GetLocation() override {
     return lex::Location{};
   }
 
-  std::vector<Declaration*> decls_;
+  std::span<Declaration*> decls_;
 };
 
 class VarDeclStatement : public Declaration {
  public:
+  static constexpr NodeKind kKind = NodeKind::VarDecl;
+
   VarDeclStatement(lex::Token name, types::Type* type, Expression* init_expr)
-      : name_{name}, type_{type}, init_expr_{init_expr} {
+      : Declaration(kKind), name_{name}, type_{type}, init_expr_{init_expr} {
   }
 
   void Accept(Visitor* visitor) override {
@@ -44,11 +55,11 @@ class VarDeclStatement : public Declaration {
   }
 
   lex::Location GetLocation() override {
-    return name_.location;
+    return name_.GetLocation();
   }
 
-  std::string_view GetName() override {
-    return name_.GetIdentifier();
+  std::string_view GetName(const lex::SourceTable& sources) override {
+    return name_.GetIdentifier(sources);
   }
 
   lex::Token name_;
@@ -56,27 +67,91 @@ class VarDeclStatement : public Declaration {
   Expression* init_expr_;
 };
 
+// Parses function bodies the parser skipped over, see
+// parse::Parser::SetLazyBodies
+class BodyParser {
+ public:
+  // Tokens [begin; end) of the source the tree was parsed from
+  virtual Expression* ParseBody(size_t begin, size_t end) = 0;
+
+ protected:
+  ~BodyParser() = default;
+};
+
 class FunDeclStatement : public Declaration {
  public:
-  FunDeclStatement(lex::Token name, std::vector<lex::Token> params, types::FunctionType* type, Expression* body)
-      : name_{name}, params_{std::move(params)}, type_{type}, body_{body} {
+  static constexpr NodeKind kKind = NodeKind::FunDecl;
+
+  FunDeclStatement(lex::Token name, std::span<lex::Token> params, types::FunctionType* type, Expression* body)
+      : Declaration(kKind), name_{name}, params_{params}, type_{type}, body_{body} {
   }
 
   void Accept(Visitor* visitor) override {
     visitor->VisitFunDeclaration(this);
   }
 
-  std::string_view GetName() override {
-    return name_.GetIdentifier();
+  std::string_view GetName(const lex::SourceTable& sources) override {
+    return name_.GetIdentifier(sources);
   }
 
   lex::Location GetLocation() override {
-    return name_.location;
+    return name_.GetLocation();
+  }
+
+  // Leaves the body to be parsed on the first GetBody()
+  void SetLazyBody(BodyParser* parser, size_t begin, size_t end) {
+    body_ = nullptr;
+    body_parser_ = parser;
+    body_begin_ = begin;
+    body_end_ = end;
+  }
+
+  Expression* GetBody() {
+    if (body_ == nullptr && body_parser_ != nullptr) {
+      body_ = body_parser_->ParseBody(body_begin_, body_end_);
+      body_parser_ = nullptr;
+    }
+
+    return body_;
+  }
+
+  bool IsBodyParsed() const {
+    return body_parser_ == nullptr;
   }
 
   lex::Token name_;
-  std::vector<lex::Token> params_;
+  std::span<lex::Token> params_;
   types::FunctionType* type_;
+  // Null until GetBody() if the body is lazy
   Expression* body_;
+
+ private:
+  BodyParser* body_parser_ = nullptr;
+  size_t body_begin_ = 0;
+  size_t body_end_ = 0;
+};
+
+// Placeholder for a statement or declaration which failed to parse.
+// Declares nothing, passes skip it
+class ErrorStatement : public Declaration {
+ public:
+  static constexpr NodeKind kKind = NodeKind::ErrorStatement;
+
+  explicit ErrorStatement(lex::Location location) : Declaration(kKind), location_{location} {
+  }
+
+  void Accept(Visitor* visitor) override {
+    visitor->VisitErrorStatement(this);
+  }
+
+  std::string_view GetName(const lex::SourceTable&) override {
+    return {};
+  }
+
+  lex::Location GetLocation() override {
+    return location_;
+  }
+
+  lex::Location location_;
 };
-}  // namespace ast
\ No newline at end of file
+}  // namespace ast
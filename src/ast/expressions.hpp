@@ -5,24 +5,41 @@
 #include <lex/token.hpp>
 #include <types/type.hpp>
 #include <utility>
-#include <vector>
+#include <span>
 
 //////////////////////////////////////////////////////////////////////
 
 namespace ast {
 
+struct Symbol;
+
 class Expression : public TreeNode {
  public:
+  using TreeNode::TreeNode;
+
+  static bool classof(const TreeNode* node) {
+    return node->GetKind() >= NodeKind::Comparison && node->GetKind() <= NodeKind::ErrorExpression;
+  }
+
   types::Type* type = nullptr;
 };
 
 // Assignable entity
-class LvalueExpression : public Expression {};
+class LvalueExpression : public Expression {
+ public:
+  using Expression::Expression;
+
+  static bool classof(const TreeNode* node) {
+    return node->GetKind() == NodeKind::VarAccess;
+  }
+};
 
 class ComparisonExpression : public Expression {
  public:
+  static constexpr NodeKind kKind = NodeKind::Comparison;
+
   ComparisonExpression(lex::Token operation, Expression* lhs, Expression* rhs)
-      : operation_{operation}, lhs_{lhs}, rhs_{rhs} {
+      : Expression(kKind), operation_{operation}, lhs_{lhs}, rhs_{rhs} {
   }
 
   void Accept(Visitor* visitor) override {
@@ -30,7 +47,7 @@ class ComparisonExpression : public Expression {
   }
 
   lex::Location GetLocation() override {
-    return operation_.location;
+    return operation_.GetLocation();
   }
 
   lex::Token operation_;
@@ -40,8 +57,10 @@ class ComparisonExpression : public Expression {
 
 class BinaryExpression : public Expression {
  public:
+  static constexpr NodeKind kKind = NodeKind::Binary;
+
   BinaryExpression(lex::Token operation, Expression* lhs, Expression* rhs)
-      : operation_{operation}, lhs_{lhs}, rhs_{rhs} {
+      : Expression(kKind), operation_{operation}, lhs_{lhs}, rhs_{rhs} {
   }
 
   void Accept(Visitor* visitor) override {
@@ -59,8 +78,10 @@ class BinaryExpression : public Expression {
 
 class UnaryExpression : public Expression {
  public:
+  static constexpr NodeKind kKind = NodeKind::Unary;
+
   UnaryExpression(lex::Token operation, Expression* expr)
-      : operation_{operation}, expr_{expr} {
+      : Expression(kKind), operation_{operation}, expr_{expr} {
   }
 
   void Accept(Visitor* visitor) override {
@@ -68,7 +89,7 @@ class UnaryExpression : public Expression {
   }
 
   lex::Location GetLocation() override {
-    return operation_.location;
+    return operation_.GetLocation();
   }
 
   lex::Token operation_;
@@ -77,8 +98,10 @@ class UnaryExpression : public Expression {
 
 class FnCallExpression : public Expression {
  public:
-  FnCallExpression(Expression* callable, std::vector<Expression*> args)
-      : callable_{callable}, args_{std::move(args)} {
+  static constexpr NodeKind kKind = NodeKind::FnCall;
+
+  FnCallExpression(Expression* callable, std::span<Expression*> args)
+      : Expression(kKind), callable_{callable}, args_{args} {
   }
 
   void Accept(Visitor* visitor) override {
@@ -90,12 +113,14 @@ class FnCallExpression : public Expression {
   }
 
   Expression* callable_;
-  std::vector<Expression*> args_;
+  std::span<Expression*> args_;
 };
 class BlockExpression : public Expression {
  public:
-  explicit BlockExpression(std::vector<Statement*> statements)
-      : statements_{std::move(statements)} {
+  static constexpr NodeKind kKind = NodeKind::Block;
+
+  explicit BlockExpression(std::span<Statement*> statements)
+      : Expression(kKind), statements_{statements} {
   }
 
   void Accept(Visitor* visitor) override {
@@ -107,14 +132,16 @@ class BlockExpression : public Expression {
     return lex::Location{};
   }
 
-  std::vector<Statement*> statements_;
+  std::span<Statement*> statements_;
 };
 
 class IfExpression : public Expression {
  public:
+  static constexpr NodeKind kKind = NodeKind::If;
+
   IfExpression(lex::Token if_token, Expression* condition,
                Expression* then_branch, Expression* else_branch = nullptr)
-      : if_token_{if_token},
+      : Expression(kKind), if_token_{if_token},
         condition_{condition},
         then_branch_{then_branch},
         else_branch_{else_branch} {
@@ -125,7 +152,7 @@ class IfExpression : public Expression {
   }
 
   lex::Location GetLocation() override {
-    return if_token_.location;
+    return if_token_.GetLocation();
   }
 
   lex::Token if_token_;
@@ -136,7 +163,9 @@ class IfExpression : public Expression {
 
 class LiteralExpression : public Expression {
  public:
-  explicit LiteralExpression(lex::Token literal) : literal_{literal} {
+  static constexpr NodeKind kKind = NodeKind::Literal;
+
+  explicit LiteralExpression(lex::Token literal) : Expression(kKind), literal_{literal} {
   }
 
   void Accept(Visitor* visitor) override {
@@ -144,15 +173,19 @@ class LiteralExpression : public Expression {
   }
 
   lex::Location GetLocation() override {
-    return literal_.location;
+    return literal_.GetLocation();
   }
 
   lex::Token literal_;
+  // Declaration an identifier refers to, bound by passes::DefinitionChecker
+  Symbol* symbol = nullptr;
 };
 
 class VarAccessExpression : public LvalueExpression {
  public:
-  explicit VarAccessExpression(lex::Token name) : name_{name} {
+  static constexpr NodeKind kKind = NodeKind::VarAccess;
+
+  explicit VarAccessExpression(lex::Token name) : LvalueExpression(kKind), name_{name} {
   }
 
   void Accept(Visitor* visitor) override {
@@ -160,7 +193,7 @@ class VarAccessExpression : public LvalueExpression {
   }
 
   lex::Location GetLocation() override {
-    return name_.location;
+    return name_.GetLocation();
   }
 
   lex::Token name_;
@@ -168,8 +201,10 @@ class VarAccessExpression : public LvalueExpression {
 
 class ReturnExpression : public Expression {
  public:
+  static constexpr NodeKind kKind = NodeKind::Return;
+
   explicit ReturnExpression(lex::Token return_token, Expression* expr)
-      : return_token_{return_token}, expr_{expr} {
+      : Expression(kKind), return_token_{return_token}, expr_{expr} {
   }
 
   void Accept(Visitor* visitor) override {
@@ -177,7 +212,7 @@ class ReturnExpression : public Expression {
   }
 
   lex::Location GetLocation() override {
-    return return_token_.location;
+    return return_token_.GetLocation();
   }
 
   lex::Token return_token_;
@@ -186,8 +221,10 @@ class ReturnExpression : public Expression {
 
 class YieldExpression : public Expression {
  public:
+  static constexpr NodeKind kKind = NodeKind::Yield;
+
   explicit YieldExpression(lex::Token yield_token, Expression* expr)
-      : yield_token_{yield_token}, expr_{expr} {
+      : Expression(kKind), yield_token_{yield_token}, expr_{expr} {
   }
 
   void Accept(Visitor* visitor) override {
@@ -195,11 +232,30 @@ class YieldExpression : public Expression {
   }
 
   lex::Location GetLocation() override {
-    return yield_token_.location;
+    return yield_token_.GetLocation();
   }
 
   lex::Token yield_token_;
   Expression* expr_;
 };
 
+// Placeholder for an expression which failed to parse
+class ErrorExpression : public Expression {
+ public:
+  static constexpr NodeKind kKind = NodeKind::ErrorExpression;
+
+  explicit ErrorExpression(lex::Location location) : Expression(kKind), location_{location} {
+  }
+
+  void Accept(Visitor* visitor) override {
+    visitor->VisitErrorExpression(this);
+  }
+
+  lex::Location GetLocation() override {
+    return location_;
+  }
+
+  lex::Location location_;
+};
+
 }  // namespace ast
\ No newline at end of file
@@ -0,0 +1,273 @@
+#pragma once
+
+#include <ast/arena.hpp>
+#include <ast/declarations.hpp>
+#include <ast/expressions.hpp>
+#include <ast/node_kind.hpp>
+#include <ast/statements.hpp>
+#include <lex/token.hpp>
+#include <types/type.hpp>
+
+#include <fmt/core.h>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+//////////////////////////////////////////////////////////////////////
+
+namespace ast {
+
+using NodeId = uint32_t;
+
+inline constexpr NodeId kNoNode = UINT32_MAX;
+
+//////////////////////////////////////////////////////////////////////
+
+// The syntax of a Program as parallel arrays indexed by NodeId, nodes in
+// pre-order: a parent comes before its children, siblings in source
+// order. Passes can walk the columns linearly instead of chasing
+// pointers through Accept. Each node has a kind, a token and two
+// operands whose meaning depends on the kind:
+//
+//   Program          lhs = list of declarations
+//   VarDecl          token = name, lhs = initializer, rhs = type index
+//   FunDecl          token = name, lhs = body, rhs = list of the type
+//                    index followed by Param nodes
+//   Param            token = name
+//   ExprStatement    lhs = expression
+//   Assignment       token = '=', lhs = target, rhs = value
+//   Comparison       token = operator, lhs, rhs
+//   Binary           token = operator, lhs, rhs
+//   Unary            token = operator, lhs = operand
+//   FnCall           lhs = callable, rhs = list of arguments
+//   Block            lhs = list of statements
+//   If               token = 'if', lhs = condition, rhs = list of the
+//                    then and else branches, else may be kNoNode
+//   Literal          token = literal
+//   VarAccess        token = name
+//   Return, Yield    token = keyword, lhs = expression
+//   Error*           token = DUMMY at the error location
+//
+// Tokens are split into columns too and share one source file. Only
+// what the parser produced is kept, annotations of passes (scopes,
+// expression types) are not. See ast::FlatTreeBuilder for the other
+// direction of ToProgram()
+class FlatTree {
+  // Reads and writes the columns directly
+  friend struct BinaryAst;
+
+ public:
+  size_t Size() const {
+    return kinds_.size();
+  }
+
+  // The Program node, if any
+  NodeId GetRoot() const {
+    return kinds_.empty() ? kNoNode : 0;
+  }
+
+  NodeKind GetKind(NodeId id) const {
+    return kinds_[id];
+  }
+
+  lex::Token GetToken(NodeId id) const {
+    return lex::Token(token_types_[id], lex::Location(offsets_[id], source_id_), payloads_[id]);
+  }
+
+  uint32_t GetLhs(NodeId id) const {
+    return lhs_[id];
+  }
+
+  uint32_t GetRhs(NodeId id) const {
+    return rhs_[id];
+  }
+
+  // Items of the list starting at `index` of lists_
+  std::span<const uint32_t> GetList(uint32_t index) const {
+    return {lists_.data() + index + 1, lists_[index]};
+  }
+
+  types::Type* GetType(uint32_t index) const {
+    return types_[index];
+  }
+
+  // Memory taken by the columns
+  size_t GetBytesUsed() const {
+    return kinds_.size() * (sizeof(NodeKind) + sizeof(lex::TokenType) + 4 * sizeof(uint32_t)) +
+           lists_.size() * sizeof(uint32_t) + types_.size() * sizeof(types::Type*);
+  }
+
+  ////////////////////////////////////////////////////////////////////
+
+  NodeId AddNode(NodeKind kind, lex::Token token) {
+    FMT_ASSERT(kinds_.size() < kNoNode, "Too many nodes for 32-bit ids\n");
+
+    if (token.source_id != lex::kNoSource) {
+      FMT_ASSERT(source_id_ == lex::kNoSource || source_id_ == token.source_id,
+                 "Flat tree spans several source files\n");
+      source_id_ = token.source_id;
+    }
+
+    kinds_.push_back(kind);
+    token_types_.push_back(token.type);
+    offsets_.push_back(token.offset);
+    payloads_.push_back(token.payload);
+    lhs_.push_back(kNoNode);
+    rhs_.push_back(kNoNode);
+    return static_cast<NodeId>(kinds_.size() - 1);
+  }
+
+  void SetOperands(NodeId id, uint32_t lhs, uint32_t rhs = kNoNode) {
+    lhs_[id] = lhs;
+    rhs_[id] = rhs;
+  }
+
+  uint32_t AddList(const std::vector<uint32_t>& items) {
+    auto index = static_cast<uint32_t>(lists_.size());
+    lists_.push_back(static_cast<uint32_t>(items.size()));
+    lists_.insert(lists_.end(), items.begin(), items.end());
+    return index;
+  }
+
+  uint32_t AddType(types::Type* type) {
+    types_.push_back(type);
+    return static_cast<uint32_t>(types_.size() - 1);
+  }
+
+  ////////////////////////////////////////////////////////////////////
+
+  // Rebuilds the class tree in `arena`, so the existing passes can run
+  Program* ToProgram(Arena& arena) const {
+    FMT_ASSERT(GetRoot() != kNoNode && GetKind(GetRoot()) == NodeKind::Program,
+               "Flat tree holds no program\n");
+
+    std::vector<Declaration*> decls;
+    for (NodeId decl : GetList(GetLhs(GetRoot()))) {
+      decls.push_back(static_cast<Declaration*>(ToStatement(decl, arena)));
+    }
+
+    return arena.New<Program>(arena.NewArray(decls));
+  }
+
+ private:
+  Statement* ToStatement(NodeId id, Arena& arena) const {
+    lex::Token token = GetToken(id);
+
+    switch (GetKind(id)) {
+      case NodeKind::VarDecl:
+        return arena.New<VarDeclStatement>(token, GetType(GetRhs(id)),
+                                           ToExpression(GetLhs(id), arena));
+
+      case NodeKind::FunDecl: {
+        std::span<const uint32_t> list = GetList(GetRhs(id));
+
+        std::vector<lex::Token> params;
+        for (NodeId param : list.subspan(1)) {
+          params.push_back(GetToken(param));
+        }
+
+        auto* type = static_cast<types::FunctionType*>(GetType(list[0]));
+        return arena.New<FunDeclStatement>(token, arena.NewArray(params), type,
+                                           ToExpression(GetLhs(id), arena));
+      }
+
+      case NodeKind::ExprStatement:
+        return arena.New<ExprStatement>(ToExpression(GetLhs(id), arena));
+
+      case NodeKind::Assignment:
+        return arena.New<AssignmentStatement>(token, ToExpression(GetLhs(id), arena),
+                                              ToExpression(GetRhs(id), arena));
+
+      case NodeKind::ErrorStatement:
+        return arena.New<ErrorStatement>(token.GetLocation());
+
+      default:
+        FMT_ASSERT(false, "Not a statement node\n");
+    }
+  }
+
+  Expression* ToExpression(NodeId id, Arena& arena) const {
+    if (id == kNoNode) {
+      return nullptr;
+    }
+
+    lex::Token token = GetToken(id);
+
+    switch (GetKind(id)) {
+      case NodeKind::Comparison:
+        return arena.New<ComparisonExpression>(token, ToExpression(GetLhs(id), arena),
+                                               ToExpression(GetRhs(id), arena));
+
+      case NodeKind::Binary:
+        return arena.New<BinaryExpression>(token, ToExpression(GetLhs(id), arena),
+                                           ToExpression(GetRhs(id), arena));
+
+      case NodeKind::Unary:
+        return arena.New<UnaryExpression>(token, ToExpression(GetLhs(id), arena));
+
+      case NodeKind::FnCall: {
+        std::vector<Expression*> args;
+        for (NodeId arg : GetList(GetRhs(id))) {
+          args.push_back(ToExpression(arg, arena));
+        }
+
+        return arena.New<FnCallExpression>(ToExpression(GetLhs(id), arena),
+                                           arena.NewArray(args));
+      }
+
+      case NodeKind::Block: {
+        std::vector<Statement*> statements;
+        for (NodeId stmt : GetList(GetLhs(id))) {
+          statements.push_back(ToStatement(stmt, arena));
+        }
+
+        return arena.New<BlockExpression>(arena.NewArray(statements));
+      }
+
+      case NodeKind::If: {
+        std::span<const uint32_t> branches = GetList(GetRhs(id));
+        return arena.New<IfExpression>(token, ToExpression(GetLhs(id), arena),
+                                       ToExpression(branches[0], arena),
+                                       ToExpression(branches[1], arena));
+      }
+
+      case NodeKind::Literal:
+        return arena.New<LiteralExpression>(token);
+
+      case NodeKind::VarAccess:
+        return arena.New<VarAccessExpression>(token);
+
+      case NodeKind::Return:
+        return arena.New<ReturnExpression>(token, ToExpression(GetLhs(id), arena));
+
+      case NodeKind::Yield:
+        return arena.New<YieldExpression>(token, ToExpression(GetLhs(id), arena));
+
+      case NodeKind::ErrorExpression:
+        return arena.New<ErrorExpression>(token.GetLocation());
+
+      default:
+        FMT_ASSERT(false, "Not an expression node\n");
+    }
+  }
+
+ private:
+  std::vector<NodeKind> kinds_;
+  std::vector<lex::TokenType> token_types_;
+  std::vector<uint32_t> offsets_;
+  std::vector<uint32_t> payloads_;
+  std::vector<uint32_t> lhs_;
+  std::vector<uint32_t> rhs_;
+
+  // Variable-length operands: a length followed by the items
+  std::vector<uint32_t> lists_;
+  // Declared types of VarDecl and FunDecl
+  std::vector<types::Type*> types_;
+
+  lex::SourceId source_id_ = lex::kNoSource;
+};
+
+}  // namespace ast
+
+//////////////////////////////////////////////////////////////////////
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+
+//////////////////////////////////////////////////////////////////////
+
+namespace ast {
+
+// Concrete kind of a syntax node, stored in every TreeNode and in the
+// columns of a FlatTree. Values are part of the binary AST format.
+// Statement and Expression kinds are contiguous, their classof checks
+// are range compares
+enum class NodeKind : uint8_t {
+  Program,
+  VarDecl,
+  FunDecl,
+  // Only in a FlatTree, parameters are plain tokens of a FunDeclStatement
+  Param,
+
+  ExprStatement,
+  Assignment,
+  ErrorStatement,
+
+  Comparison,
+  Binary,
+  Unary,
+  FnCall,
+  Block,
+  If,
+  Literal,
+  VarAccess,
+  Return,
+  Yield,
+  ErrorExpression,
+};
+
+}  // namespace ast
+
+//////////////////////////////////////////////////////////////////////
@@ -13,12 +13,21 @@ namespace ast {
 
 class Statement : public ast::TreeNode {
  public:
+  using TreeNode::TreeNode;
+
+  static bool classof(const TreeNode* node) {
+    return node->GetKind() >= NodeKind::VarDecl && node->GetKind() <= NodeKind::ErrorStatement &&
+           node->GetKind() != NodeKind::Param;
+  }
+
   void Accept(Visitor* /* visitor */) override{};
 };
 
 class ExprStatement : public Statement {
  public:
-  explicit ExprStatement(Expression* expr) : expr_{expr} {
+  static constexpr NodeKind kKind = NodeKind::ExprStatement;
+
+  explicit ExprStatement(Expression* expr) : Statement(kKind), expr_{expr} {
   }
 
   void Accept(Visitor* visitor) override {
@@ -34,9 +43,11 @@ class ExprStatement : public Statement {
 
 class AssignmentStatement : public Statement {
  public:
+  static constexpr NodeKind kKind = NodeKind::Assignment;
+
   explicit AssignmentStatement(lex::Token assn_token, Expression* lhs,
                                Expression* rhs)
-      : assn_token_{assn_token}, lhs_{lhs}, rhs_{rhs} {
+      : Statement(kKind), assn_token_{assn_token}, lhs_{lhs}, rhs_{rhs} {
   }
 
   void Accept(Visitor* visitor) override {
@@ -44,7 +55,7 @@ class AssignmentStatement : public Statement {
   }
 
   lex::Location GetLocation() override {
-    return assn_token_.location;
+    return assn_token_.GetLocation();
   }
 
   lex::Token assn_token_;
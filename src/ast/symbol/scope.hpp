@@ -18,37 +18,44 @@ class Scope {
     return location_;
   }
 
-  bool AddSymbol(Symbol symbol) {
-    if (symbols_.find(symbol.name) != symbols_.end()) {
-      return false;
-    }
+  // The symbol is not owned, it must outlive the scope
+  bool AddSymbol(Symbol* symbol) {
+    return symbols_.emplace(symbol->id, symbol).second;
+  }
 
-    symbols_[symbol.name] = symbol;
-    return true;
+  // Symbol declared here under `id`, wherever it is visible
+  Symbol* Find(lex::SymbolId id) {
+    auto it = symbols_.find(id);
+    return it != symbols_.end() ? it->second : nullptr;
   }
 
-  Symbol* LookupLocal(const std::string_view& name, const lex::Location& location) {
-    for (auto& [symbol_name, symbol] : symbols_) {
-      if (symbol_name == name && (symbol.global_scope || (symbol.location < location))) {
-        return &symbol;
-      }
+  Symbol* LookupLocal(lex::SymbolId id, const lex::Location& location) {
+    Symbol* symbol = Find(id);
+    if (symbol == nullptr) {
+      return nullptr;
+    }
+
+    // Locals are visible only after their declaration
+    if (symbol->global_scope || symbol->location < location) {
+      return symbol;
     }
 
     return nullptr;
   }
 
-  Symbol* Lookup(const std::string_view& name, const lex::Location& location) {
-    Symbol* local = LookupLocal(name, location);
-    if (local != nullptr) {
-      return local;
+  Symbol* Lookup(lex::SymbolId id, const lex::Location& location) {
+    // If symbol is not present locally, search it in parent scopes
+    for (Scope* scope = this; scope != nullptr; scope = scope->GetParent()) {
+      if (Symbol* local = scope->LookupLocal(id, location)) {
+        return local;
+      }
     }
 
-    // If symbol is not present locally, search it in parent scopes
-    return parent_ != nullptr ? GetParent()->Lookup(name, location) : nullptr;
+    return nullptr;
   }
 
  private:
-  std::unordered_map<std::string_view, Symbol> symbols_;
+  std::unordered_map<lex::SymbolId, Symbol*> symbols_;
   lex::Location location_;
   Scope* parent_;
 
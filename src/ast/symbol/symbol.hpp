@@ -1,7 +1,9 @@
 #pragma once
 
 #include <string_view>
+#include <variant>
 #include <ast/declarations.hpp>
+#include <lex/ident_table.hpp>
 #include <types/type.hpp>
 
 namespace ast {
@@ -27,6 +29,8 @@ struct TypeSymbol {
 
 struct Symbol {
   SymbolType type = SymbolType::Dummy;
+  lex::SymbolId id = 0;
+  // Interned, outlives the source buffer
   std::string_view name;
   lex::Location location;
   bool global_scope = false;
@@ -1,8 +1,10 @@
 #pragma once
 
+#include <ast/node_kind.hpp>
 #include <ast/visitors/visitor.hpp>
 #include <lex/location.hpp>
 #include <ast/symbol/scope.hpp>
+#include <utils/casting.hpp>
 
 //////////////////////////////////////////////////////////////////////
 
@@ -10,18 +12,32 @@ namespace ast {
 
 class TreeNode {
  public:
-  virtual ~TreeNode() = default;
-
   virtual void Accept(Visitor* visitor) = 0;
   virtual lex::Location GetLocation() = 0;
 
+  NodeKind GetKind() const {
+    return kind_;
+  }
+
   template <typename T>
   T* as() {
-    return dynamic_cast<T*>(this);
+    return utils::dyn_cast<T>(this);
   }
 
  public:
+  // Set by passes::SymbolTableBuilder, valid while the builder lives
   Scope* scope = nullptr;
+
+ protected:
+  explicit TreeNode(NodeKind kind) : kind_(kind) {
+  }
+
+  // Nodes live in an ast::Arena and are never deleted one by one,
+  // a trivial destructor lets the arena skip them on teardown
+  ~TreeNode() = default;
+
+ private:
+  NodeKind kind_;
 };
 }  // namespace ast
 
@@ -1,85 +1,69 @@
 #pragma once
 
-#include <ast/declarations.hpp>
-#include <ast/visitors/visitor.hpp>
+#include <ast/visitors/static_visitor.hpp>
 
 namespace ast {
 
-/// Base traversal behavior, so you can redefine only necessary parts
-class BaseVisitor : public Visitor {
+/// Base traversal behavior, so you can redefine only necessary parts.
+/// Accepting any node walks its subtree with an explicit stack, so deep
+/// trees (long operator chains, else-if ladders) cost heap rather than
+/// call stack. Enter* hooks run before the children of a node, Leave*
+/// hooks after them. The hooks are virtual, see StaticVisitor for the
+/// statically dispatched walk this is built on
+class BaseVisitor : public StaticVisitor<BaseVisitor> {
  public:
-  void VisitProgram(Program* prg) override {
-    for (Declaration* decl : prg->decls_) {
-      decl->Accept(this);
-    }
-  }
-
-  void VisitComparisonExpression(ComparisonExpression* expr) override {
-    expr->lhs_->Accept(this);
-    expr->rhs_->Accept(this);
-  }
-
-  void VisitBinaryExpression(BinaryExpression* expr) override {
-    expr->lhs_->Accept(this);
-    expr->rhs_->Accept(this);
-  }
-
-  void VisitUnaryExpression(UnaryExpression* expr) override {
-    expr->expr_->Accept(this);
-  }
-
-  void VisitIfExpression(IfExpression* expr) override {
-    expr->condition_->Accept(this);
-    expr->then_branch_->Accept(this);
-    if (expr->else_branch_ != nullptr) {
-      expr->else_branch_->Accept(this);
-    }
-  }
-
-  void VisitBlockExpression(BlockExpression* expr) override {
-    for (Statement* stmt : expr->statements_) {
-      stmt->Accept(this);
-    }
-  }
-
-  void VisitFnCallExpression(FnCallExpression* expr) override {
-    expr->callable_->Accept(this);
-    for (Expression* arg : expr->args_)  {
-      arg->Accept(this);
-    }
-  }
-
-  void VisitLiteralExpression(LiteralExpression*) override {
-    // Leaf node
-  }
-
-  void VisitVarAccessExpression(VarAccessExpression*) override {
-    // Leaf node
-  }
-
-  void VisitYieldExpression(YieldExpression* expr) override {
-    expr->expr_->Accept(this);
-  }
-
-  void VisitReturnExpression(ReturnExpression* expr) override {
-    expr->expr_->Accept(this);
-  }
-
-  void VisitExprStatement(ExprStatement* stmt) override {
-    stmt->expr_->Accept(this);
-  }
-
-  void VisitAssignmentStatement(AssignmentStatement* stmt) override {
-    stmt->lhs_->Accept(this);
-    stmt->rhs_->Accept(this);
-  }
-
-  void VisitVarDeclaration(VarDeclStatement* decl) override {
-    decl->init_expr_->Accept(this);
-  }
-
-  void VisitFunDeclaration(FunDeclStatement* decl) override {
-    decl->body_->Accept(this);
-  }
+  virtual void EnterProgram(Program*) {}
+  virtual void LeaveProgram(Program*) {}
+
+  virtual void EnterComparisonExpression(ComparisonExpression*) {}
+  virtual void LeaveComparisonExpression(ComparisonExpression*) {}
+
+  virtual void EnterBinaryExpression(BinaryExpression*) {}
+  virtual void LeaveBinaryExpression(BinaryExpression*) {}
+
+  virtual void EnterUnaryExpression(UnaryExpression*) {}
+  virtual void LeaveUnaryExpression(UnaryExpression*) {}
+
+  virtual void EnterIfExpression(IfExpression*) {}
+  virtual void LeaveIfExpression(IfExpression*) {}
+
+  virtual void EnterBlockExpression(BlockExpression*) {}
+  virtual void LeaveBlockExpression(BlockExpression*) {}
+
+  virtual void EnterFnCallExpression(FnCallExpression*) {}
+  virtual void LeaveFnCallExpression(FnCallExpression*) {}
+
+  virtual void EnterLiteralExpression(LiteralExpression*) {}
+  virtual void LeaveLiteralExpression(LiteralExpression*) {}
+
+  virtual void EnterVarAccessExpression(VarAccessExpression*) {}
+  virtual void LeaveVarAccessExpression(VarAccessExpression*) {}
+
+  virtual void EnterYieldExpression(YieldExpression*) {}
+  virtual void LeaveYieldExpression(YieldExpression*) {}
+
+  virtual void EnterReturnExpression(ReturnExpression*) {}
+  virtual void LeaveReturnExpression(ReturnExpression*) {}
+
+  virtual void EnterErrorExpression(ErrorExpression*) {}
+  virtual void LeaveErrorExpression(ErrorExpression*) {}
+
+  virtual void EnterExprStatement(ExprStatement*) {}
+  virtual void LeaveExprStatement(ExprStatement*) {}
+
+  virtual void EnterAssignmentStatement(AssignmentStatement*) {}
+  virtual void LeaveAssignmentStatement(AssignmentStatement*) {}
+
+  virtual void EnterErrorStatement(ErrorStatement*) {}
+  virtual void LeaveErrorStatement(ErrorStatement*) {}
+
+  virtual void EnterVarDeclaration(VarDeclStatement*) {}
+  virtual void LeaveVarDeclaration(VarDeclStatement*) {}
+
+  virtual void EnterFunDeclaration(FunDeclStatement*) {}
+  virtual void LeaveFunDeclaration(FunDeclStatement*) {}
+
+  virtual void EnterChild(TreeNode* /* parent */, size_t /* index */) {}
+  virtual void LeaveChild(TreeNode* /* parent */, size_t /* index */) {}
 };
-} // namespace ast
\ No newline at end of file
+} // namespace ast
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <ast/visitors/return_visitor.hpp>
+#include <ast/expressions.hpp>
+#include <ast/statements.hpp>
+#include <ast/declarations.hpp>
+
+#include <fmt/core.h>
+
+#include <string>
+
+namespace ast {
+
+/// Line printed above a child when dumping a tree, numbered as in
+/// BaseVisitor::EnterChild. Empty if the child is just indented
+class ChildLabel : public ReturnVisitor<std::string> {
+ public:
+  std::string Get(TreeNode* parent, size_t index) {
+    index_ = index;
+    return Eval(parent);
+  }
+
+  void VisitProgram(Program*) override {
+    return_value = fmt::format("Declaration {}:", index_);
+  }
+
+  void VisitComparisonExpression(ComparisonExpression*) override {
+    return_value = index_ == 0 ? "LHS:" : "RHS";
+  }
+
+  void VisitBinaryExpression(BinaryExpression*) override {
+    return_value = index_ == 0 ? "LHS:" : "RHS";
+  }
+
+  void VisitUnaryExpression(UnaryExpression*) override {
+    return_value = "Expression:";
+  }
+
+  void VisitIfExpression(IfExpression*) override {
+    static constexpr const char* kBranches[] = {"Condition:", "Then branch:", "Else branch:"};
+    return_value = kBranches[index_];
+  }
+
+  void VisitBlockExpression(BlockExpression*) override {
+    return_value = fmt::format("Statement {}:", index_);
+  }
+
+  void VisitFnCallExpression(FnCallExpression*) override {
+    return_value = index_ == 0 ? "Callable:" : fmt::format("Arg {}:", index_ - 1);
+  }
+
+  void VisitLiteralExpression(LiteralExpression*) override {
+    FMT_ASSERT(false, "Literal has no children\n");
+  }
+
+  void VisitVarAccessExpression(VarAccessExpression*) override {
+    FMT_ASSERT(false, "Var access has no children\n");
+  }
+
+  void VisitYieldExpression(YieldExpression*) override {
+    return_value = "Value (expression):";
+  }
+
+  void VisitReturnExpression(ReturnExpression*) override {
+    return_value = "Value (expression):";
+  }
+
+  void VisitErrorExpression(ErrorExpression*) override {
+    FMT_ASSERT(false, "Error expression has no children\n");
+  }
+
+  void VisitExprStatement(ExprStatement*) override {
+    return_value = "";
+  }
+
+  void VisitAssignmentStatement(AssignmentStatement*) override {
+    return_value = index_ == 0 ? "Lvalue:" : "Assigned expression:";
+  }
+
+  void VisitErrorStatement(ErrorStatement*) override {
+    FMT_ASSERT(false, "Error statement has no children\n");
+  }
+
+  void VisitVarDeclaration(VarDeclStatement*) override {
+    return_value = "Initializer:";
+  }
+
+  void VisitFunDeclaration(FunDeclStatement*) override {
+    return_value = "Body:";
+  }
+
+ private:
+  size_t index_ = 0;
+};
+} // namespace ast
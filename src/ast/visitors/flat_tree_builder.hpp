@@ -0,0 +1,168 @@
+#pragma once
+
+#include <ast/flat_tree.hpp>
+#include <ast/visitors/visitor.hpp>
+
+#include <utility>
+
+namespace ast {
+
+/// Lays a class tree out as a FlatTree, see FlatTree::ToProgram for the
+/// way back. Forces lazy function bodies
+class FlatTreeBuilder : public Visitor {
+ public:
+  FlatTree TakeTree() {
+    return std::move(tree_);
+  }
+
+  void VisitProgram(Program* prg) override {
+    NodeId id = tree_.AddNode(NodeKind::Program, lex::Token{});
+
+    std::vector<uint32_t> decls;
+    for (Declaration* decl : prg->decls_) {
+      decls.push_back(Flatten(decl));
+    }
+
+    tree_.SetOperands(id, tree_.AddList(decls));
+    last_ = id;
+  }
+
+  void VisitComparisonExpression(ComparisonExpression* expr) override {
+    AddBinary(NodeKind::Comparison, expr->operation_, expr->lhs_, expr->rhs_);
+  }
+
+  void VisitBinaryExpression(BinaryExpression* expr) override {
+    AddBinary(NodeKind::Binary, expr->operation_, expr->lhs_, expr->rhs_);
+  }
+
+  void VisitUnaryExpression(UnaryExpression* expr) override {
+    AddUnary(NodeKind::Unary, expr->operation_, expr->expr_);
+  }
+
+  void VisitIfExpression(IfExpression* expr) override {
+    NodeId id = tree_.AddNode(NodeKind::If, expr->if_token_);
+    NodeId condition = Flatten(expr->condition_);
+    NodeId then_branch = Flatten(expr->then_branch_);
+    NodeId else_branch = Flatten(expr->else_branch_);
+
+    tree_.SetOperands(id, condition, tree_.AddList({then_branch, else_branch}));
+    last_ = id;
+  }
+
+  void VisitBlockExpression(BlockExpression* expr) override {
+    NodeId id = tree_.AddNode(NodeKind::Block, lex::Token{});
+
+    std::vector<uint32_t> statements;
+    for (Statement* stmt : expr->statements_) {
+      statements.push_back(Flatten(stmt));
+    }
+
+    tree_.SetOperands(id, tree_.AddList(statements));
+    last_ = id;
+  }
+
+  void VisitFnCallExpression(FnCallExpression* expr) override {
+    NodeId id = tree_.AddNode(NodeKind::FnCall, lex::Token{});
+    NodeId callable = Flatten(expr->callable_);
+
+    std::vector<uint32_t> args;
+    for (Expression* arg : expr->args_) {
+      args.push_back(Flatten(arg));
+    }
+
+    tree_.SetOperands(id, callable, tree_.AddList(args));
+    last_ = id;
+  }
+
+  void VisitLiteralExpression(LiteralExpression* expr) override {
+    last_ = tree_.AddNode(NodeKind::Literal, expr->literal_);
+  }
+
+  void VisitVarAccessExpression(VarAccessExpression* expr) override {
+    last_ = tree_.AddNode(NodeKind::VarAccess, expr->name_);
+  }
+
+  void VisitYieldExpression(YieldExpression* expr) override {
+    AddUnary(NodeKind::Yield, expr->yield_token_, expr->expr_);
+  }
+
+  void VisitReturnExpression(ReturnExpression* expr) override {
+    AddUnary(NodeKind::Return, expr->return_token_, expr->expr_);
+  }
+
+  void VisitErrorExpression(ErrorExpression* expr) override {
+    last_ = tree_.AddNode(NodeKind::ErrorExpression,
+                          lex::Token(lex::TokenType::DUMMY, expr->GetLocation()));
+  }
+
+  ////////////////////////////////////////////////////////////////////
+
+  void VisitExprStatement(ExprStatement* stmt) override {
+    AddUnary(NodeKind::ExprStatement, lex::Token{}, stmt->expr_);
+  }
+
+  void VisitAssignmentStatement(AssignmentStatement* stmt) override {
+    AddBinary(NodeKind::Assignment, stmt->assn_token_, stmt->lhs_, stmt->rhs_);
+  }
+
+  void VisitErrorStatement(ErrorStatement* stmt) override {
+    last_ = tree_.AddNode(NodeKind::ErrorStatement,
+                          lex::Token(lex::TokenType::DUMMY, stmt->GetLocation()));
+  }
+
+  ////////////////////////////////////////////////////////////////////
+
+  void VisitVarDeclaration(VarDeclStatement* decl) override {
+    NodeId id = tree_.AddNode(NodeKind::VarDecl, decl->name_);
+    NodeId init = Flatten(decl->init_expr_);
+
+    tree_.SetOperands(id, init, tree_.AddType(decl->type_));
+    last_ = id;
+  }
+
+  void VisitFunDeclaration(FunDeclStatement* decl) override {
+    NodeId id = tree_.AddNode(NodeKind::FunDecl, decl->name_);
+
+    std::vector<uint32_t> list{tree_.AddType(decl->type_)};
+    for (lex::Token param : decl->params_) {
+      list.push_back(tree_.AddNode(NodeKind::Param, param));
+    }
+
+    NodeId body = Flatten(decl->GetBody());
+
+    tree_.SetOperands(id, body, tree_.AddList(list));
+    last_ = id;
+  }
+
+ private:
+  NodeId Flatten(TreeNode* node) {
+    if (node == nullptr) {
+      return kNoNode;
+    }
+
+    node->Accept(this);
+    return last_;
+  }
+
+  void AddUnary(NodeKind kind, lex::Token token, Expression* operand) {
+    NodeId id = tree_.AddNode(kind, token);
+    tree_.SetOperands(id, Flatten(operand));
+    last_ = id;
+  }
+
+  void AddBinary(NodeKind kind, lex::Token token, Expression* lhs, Expression* rhs) {
+    NodeId id = tree_.AddNode(kind, token);
+    NodeId lhs_id = Flatten(lhs);
+    NodeId rhs_id = Flatten(rhs);
+
+    tree_.SetOperands(id, lhs_id, rhs_id);
+    last_ = id;
+  }
+
+ private:
+  FlatTree tree_;
+  // Node made by the last Accept
+  NodeId last_ = kNoNode;
+};
+
+}  // namespace ast
@@ -0,0 +1,228 @@
+#pragma once
+
+#include <ast/visitors/static_visitor.hpp>
+#include <errors/compile_error.hpp>
+
+#include <exception>
+#include <tuple>
+#include <utility>
+
+namespace ast {
+
+/// Runs several visitors in a single walk. At every node the Enter hooks
+/// run in the order of `Passes`, then the children are walked, then the
+/// Leave hooks run in the same order. A pass may rely on what the passes
+/// before it did at the same node or earlier in the walk.
+///
+/// Errors are reported as if the passes ran one after another. A pass
+/// that throws a CompileError is stopped and so are the passes after it,
+/// which may depend on it. The passes before it keep walking, and an
+/// error from any of them takes priority. The error is rethrown when the
+/// walk ends, or at once if the first pass has failed
+template <typename... Passes>
+class FusedVisitor : public StaticVisitor<FusedVisitor<Passes...>> {
+ public:
+  explicit FusedVisitor(Passes&... passes) : passes_{passes...} {
+  }
+
+  void Walk(TreeNode* root) {
+    stopped_ = sizeof...(Passes);
+    error_ = nullptr;
+
+    StaticVisitor<FusedVisitor>::Walk(root);
+
+    if (error_) {
+      std::rethrow_exception(error_);
+    }
+  }
+
+  // Index of the pass whose error the last walk threw, the number of
+  // passes if there was none
+  size_t GetFailedPass() const {
+    return stopped_;
+  }
+
+  ////////////////////////////////////////////////////////////////////
+
+  void EnterProgram(Program* node) {
+    Apply([node](auto& pass) { pass.EnterProgram(node); });
+  }
+
+  void LeaveProgram(Program* node) {
+    Apply([node](auto& pass) { pass.LeaveProgram(node); });
+  }
+
+  void EnterComparisonExpression(ComparisonExpression* node) {
+    Apply([node](auto& pass) { pass.EnterComparisonExpression(node); });
+  }
+
+  void LeaveComparisonExpression(ComparisonExpression* node) {
+    Apply([node](auto& pass) { pass.LeaveComparisonExpression(node); });
+  }
+
+  void EnterBinaryExpression(BinaryExpression* node) {
+    Apply([node](auto& pass) { pass.EnterBinaryExpression(node); });
+  }
+
+  void LeaveBinaryExpression(BinaryExpression* node) {
+    Apply([node](auto& pass) { pass.LeaveBinaryExpression(node); });
+  }
+
+  void EnterUnaryExpression(UnaryExpression* node) {
+    Apply([node](auto& pass) { pass.EnterUnaryExpression(node); });
+  }
+
+  void LeaveUnaryExpression(UnaryExpression* node) {
+    Apply([node](auto& pass) { pass.LeaveUnaryExpression(node); });
+  }
+
+  void EnterIfExpression(IfExpression* node) {
+    Apply([node](auto& pass) { pass.EnterIfExpression(node); });
+  }
+
+  void LeaveIfExpression(IfExpression* node) {
+    Apply([node](auto& pass) { pass.LeaveIfExpression(node); });
+  }
+
+  void EnterBlockExpression(BlockExpression* node) {
+    Apply([node](auto& pass) { pass.EnterBlockExpression(node); });
+  }
+
+  void LeaveBlockExpression(BlockExpression* node) {
+    Apply([node](auto& pass) { pass.LeaveBlockExpression(node); });
+  }
+
+  void EnterFnCallExpression(FnCallExpression* node) {
+    Apply([node](auto& pass) { pass.EnterFnCallExpression(node); });
+  }
+
+  void LeaveFnCallExpression(FnCallExpression* node) {
+    Apply([node](auto& pass) { pass.LeaveFnCallExpression(node); });
+  }
+
+  void EnterLiteralExpression(LiteralExpression* node) {
+    Apply([node](auto& pass) { pass.EnterLiteralExpression(node); });
+  }
+
+  void LeaveLiteralExpression(LiteralExpression* node) {
+    Apply([node](auto& pass) { pass.LeaveLiteralExpression(node); });
+  }
+
+  void EnterVarAccessExpression(VarAccessExpression* node) {
+    Apply([node](auto& pass) { pass.EnterVarAccessExpression(node); });
+  }
+
+  void LeaveVarAccessExpression(VarAccessExpression* node) {
+    Apply([node](auto& pass) { pass.LeaveVarAccessExpression(node); });
+  }
+
+  void EnterYieldExpression(YieldExpression* node) {
+    Apply([node](auto& pass) { pass.EnterYieldExpression(node); });
+  }
+
+  void LeaveYieldExpression(YieldExpression* node) {
+    Apply([node](auto& pass) { pass.LeaveYieldExpression(node); });
+  }
+
+  void EnterReturnExpression(ReturnExpression* node) {
+    Apply([node](auto& pass) { pass.EnterReturnExpression(node); });
+  }
+
+  void LeaveReturnExpression(ReturnExpression* node) {
+    Apply([node](auto& pass) { pass.LeaveReturnExpression(node); });
+  }
+
+  void EnterErrorExpression(ErrorExpression* node) {
+    Apply([node](auto& pass) { pass.EnterErrorExpression(node); });
+  }
+
+  void LeaveErrorExpression(ErrorExpression* node) {
+    Apply([node](auto& pass) { pass.LeaveErrorExpression(node); });
+  }
+
+  void EnterExprStatement(ExprStatement* node) {
+    Apply([node](auto& pass) { pass.EnterExprStatement(node); });
+  }
+
+  void LeaveExprStatement(ExprStatement* node) {
+    Apply([node](auto& pass) { pass.LeaveExprStatement(node); });
+  }
+
+  void EnterAssignmentStatement(AssignmentStatement* node) {
+    Apply([node](auto& pass) { pass.EnterAssignmentStatement(node); });
+  }
+
+  void LeaveAssignmentStatement(AssignmentStatement* node) {
+    Apply([node](auto& pass) { pass.LeaveAssignmentStatement(node); });
+  }
+
+  void EnterErrorStatement(ErrorStatement* node) {
+    Apply([node](auto& pass) { pass.EnterErrorStatement(node); });
+  }
+
+  void LeaveErrorStatement(ErrorStatement* node) {
+    Apply([node](auto& pass) { pass.LeaveErrorStatement(node); });
+  }
+
+  void EnterVarDeclaration(VarDeclStatement* node) {
+    Apply([node](auto& pass) { pass.EnterVarDeclaration(node); });
+  }
+
+  void LeaveVarDeclaration(VarDeclStatement* node) {
+    Apply([node](auto& pass) { pass.LeaveVarDeclaration(node); });
+  }
+
+  void EnterFunDeclaration(FunDeclStatement* node) {
+    Apply([node](auto& pass) { pass.EnterFunDeclaration(node); });
+  }
+
+  void LeaveFunDeclaration(FunDeclStatement* node) {
+    Apply([node](auto& pass) { pass.LeaveFunDeclaration(node); });
+  }
+
+  void EnterChild(TreeNode* parent, size_t index) {
+    Apply([parent, index](auto& pass) { pass.EnterChild(parent, index); });
+  }
+
+  void LeaveChild(TreeNode* parent, size_t index) {
+    Apply([parent, index](auto& pass) { pass.LeaveChild(parent, index); });
+  }
+
+ private:
+  template <typename Hook>
+  void Apply(const Hook& hook) {
+    Apply(hook, std::index_sequence_for<Passes...>{});
+  }
+
+  template <typename Hook, size_t... Indices>
+  void Apply(const Hook& hook, std::index_sequence<Indices...>) {
+    (Run<Indices>(hook), ...);
+  }
+
+  template <size_t Index, typename Hook>
+  void Run(const Hook& hook) {
+    if (Index >= stopped_) {
+      return;
+    }
+
+    try {
+      hook(std::get<Index>(passes_));
+    } catch (const ::errors::CompileError&) {
+      // Only passes before this one are still running, so this error
+      // outranks the one kept so far
+      error_ = std::current_exception();
+      stopped_ = Index;
+      if (Index == 0) {
+        throw;
+      }
+    }
+  }
+
+ private:
+  std::tuple<Passes&...> passes_;
+  // Passes from this index on are stopped
+  size_t stopped_ = sizeof...(Passes);
+  std::exception_ptr error_;
+};
+
+}  // namespace ast
@@ -1,7 +1,8 @@
 #pragma once
 
 #include <fmt/core.h>
-#include <ast/visitors/visitor.hpp>
+#include <ast/visitors/base_visitor.hpp>
+#include <ast/visitors/child_label.hpp>
 #include <ast/expressions.hpp>
 #include <ast/statements.hpp>
 #include <ast/declarations.hpp>
@@ -9,126 +10,97 @@
 namespace ast {
 #define INDENTED(stmt) { indent(); stmt; }
 
-class PrintVisitor : public Visitor {
+class PrintVisitor : public BaseVisitor {
  public:
-  template<typename Func>
-  void IdentBlock(Func fn) {
+  // Names and literals are decoded through `sources`
+  explicit PrintVisitor(const lex::SourceTable& sources) : sources_{sources} {
+  }
+
+  void EnterChild(TreeNode* parent, size_t index) override {
+    std::string label = labels_.Get(parent, index);
+    if (!label.empty()) {
+      INDENTED(fmt::print("{}\n", label));
+    }
     curr_tabs_++;
-    fn();
+  }
+
+  void LeaveChild(TreeNode*, size_t) override {
     curr_tabs_--;
   }
 
-  void VisitProgram(ast::Program* prg) override  {
+  void EnterProgram(ast::Program*) override  {
     INDENTED(fmt::print("Program\n"));
-    for (size_t i = 0; i < prg->decls_.size(); i++) {
-      INDENTED(fmt::print("Declaration {}:\n", i));
-      IdentBlock([&]() { prg->decls_[i]->Accept(this); });
-    }
   }
 
-  void VisitComparisonExpression(ast::ComparisonExpression* expr) override {
+  void EnterComparisonExpression(ast::ComparisonExpression* expr) override {
     INDENTED(fmt::print("Comparison: {}\n", lex::FormatTokenType(expr->operation_.type)));
-    INDENTED(fmt::print("LHS:\n"));
-    IdentBlock([&]() { expr->lhs_->Accept(this); });
-    INDENTED(fmt::print("RHS\n"));
-    IdentBlock([&]() { expr->rhs_->Accept(this); });
   }
 
-  void VisitBinaryExpression(ast::BinaryExpression* expr) override {
+  void EnterBinaryExpression(ast::BinaryExpression* expr) override {
     INDENTED(fmt::print("Binary expression: {}\n", lex::FormatTokenType(expr->operation_.type)));
-    INDENTED(fmt::print("LHS:\n"));
-    IdentBlock([&]() { expr->lhs_->Accept(this); });
-    INDENTED(fmt::print("RHS\n"));
-    IdentBlock([&]() { expr->rhs_->Accept(this); });
   }
 
-  void VisitUnaryExpression(ast::UnaryExpression* expr) override {
+  void EnterUnaryExpression(ast::UnaryExpression* expr) override {
     INDENTED(fmt::print("Unary expression: {}\n", lex::FormatTokenType(expr->operation_.type)));
-    INDENTED(fmt::print("Expression:\n"));
-    IdentBlock([&]() { expr->expr_->Accept(this); });
   }
 
-  void VisitIfExpression(ast::IfExpression* expr) override {
+  void EnterIfExpression(ast::IfExpression*) override {
     INDENTED(fmt::print("If\n"));
-    INDENTED(fmt::print("Condition:\n"));
-    IdentBlock([&]() { expr->condition_->Accept(this); });
-    INDENTED(fmt::print("Then branch:\n"));
-    IdentBlock([&]() { expr->then_branch_->Accept(this); });
-    if (expr->else_branch_ != nullptr) {
-      INDENTED(fmt::print("Else branch:\n"));
-      IdentBlock([&]() { expr->else_branch_->Accept(this); });
-    }
   }
 
-  void VisitBlockExpression(ast::BlockExpression* expr) override {
+  void EnterBlockExpression(ast::BlockExpression*) override {
     INDENTED(fmt::print("Block expression\n"));
-    for (size_t i = 0; i < expr->statements_.size(); i++) {
-      INDENTED(fmt::print("Statement {}:\n", i));
-      IdentBlock([&]() { expr->statements_[i]->Accept(this); });
-    }
   }
 
-  void VisitFnCallExpression(ast::FnCallExpression* expr) override {
+  void EnterFnCallExpression(ast::FnCallExpression*) override {
     INDENTED(fmt::print("Function call\n"));
-    INDENTED(fmt::print("Callable:\n"));
-    IdentBlock([&]() { expr->callable_->Accept(this); });
-    for (size_t i = 0; i < expr->args_.size(); i++)  {
-      INDENTED(fmt::print("Arg {}:\n", i));
-      IdentBlock([&]() { expr->args_[i]->Accept(this); });
-    }
   }
 
-  void VisitLiteralExpression(ast::LiteralExpression* expr) override {
-    INDENTED(fmt::print("Literal expression: {}\n", std::string{expr->literal_}));
+  void EnterLiteralExpression(ast::LiteralExpression* expr) override {
+    INDENTED(fmt::print("Literal expression: {}\n", expr->literal_.Format(sources_)));
   }
 
-  void VisitVarAccessExpression(ast::VarAccessExpression* expr) override {
-    INDENTED(fmt::print("Var access: {}\n", expr->name_.GetIdentifier()));
+  void EnterVarAccessExpression(ast::VarAccessExpression* expr) override {
+    INDENTED(fmt::print("Var access: {}\n", expr->name_.GetIdentifier(sources_)));
   }
 
-  void VisitReturnExpression(ast::ReturnExpression* expr) override {
+  void EnterReturnExpression(ast::ReturnExpression*) override {
     INDENTED(fmt::print("Return\n"));
-    INDENTED(fmt::print("Value (expression):\n"));
-    IdentBlock([&]() { expr->expr_->Accept(this); });
   }
 
-  void VisitYieldExpression(ast::YieldExpression* expr) override {
+  void EnterYieldExpression(ast::YieldExpression*) override {
     INDENTED(fmt::print("Yield\n"));
-    INDENTED(fmt::print("Value (expression):\n"));
-    IdentBlock([&]() { expr->expr_->Accept(this); });
   }
 
-  void VisitExprStatement(ast::ExprStatement* stmt) override {
+  void EnterExprStatement(ast::ExprStatement*) override {
     INDENTED(fmt::print("Expression statement\n"));
-    IdentBlock([&]() { stmt->expr_->Accept(this); });
   }
 
-  void VisitAssignmentStatement(ast::AssignmentStatement* stmt) override {
+  void EnterAssignmentStatement(ast::AssignmentStatement*) override {
     INDENTED(fmt::print("Assignment\n"));
-    INDENTED(fmt::print("Lvalue:\n"));
-    IdentBlock([&]() { stmt->lhs_->Accept(this); });
-    INDENTED(fmt::print("Assigned expression:\n"));
-    IdentBlock([&]() { stmt->rhs_->Accept(this); });
   }
 
-  void VisitVarDeclaration(ast::VarDeclStatement* decl) override {
-    INDENTED(fmt::print("Variable declaration: {} of type {}\n", decl->GetName(), decl->type_->Format()));
-    INDENTED(fmt::print("Initializer:\n"));
-    IdentBlock([&]() { decl->init_expr_->Accept(this); });
+  void EnterErrorExpression(ast::ErrorExpression*) override {
+    INDENTED(fmt::print("Error expression\n"));
   }
 
-  void VisitFunDeclaration(ast::FunDeclStatement* decl) override {
-    INDENTED(fmt::print("Function declaration: {} of type {}\n", decl->GetName(), decl->type_->Format()));
+  void EnterErrorStatement(ast::ErrorStatement*) override {
+    INDENTED(fmt::print("Error statement\n"));
+  }
+
+  void EnterVarDeclaration(ast::VarDeclStatement* decl) override {
+    INDENTED(fmt::print("Variable declaration: {} of type {}\n", decl->GetName(sources_), decl->type_->Format()));
+  }
+
+  void EnterFunDeclaration(ast::FunDeclStatement* decl) override {
+    INDENTED(fmt::print("Function declaration: {} of type {}\n", decl->GetName(sources_), decl->type_->Format()));
 
     INDENTED(fmt::print("Params: "));
     for (auto& param : decl->params_) {
-      fmt::print("{}", param.GetIdentifier());
+      fmt::print("{}", param.GetIdentifier(sources_));
       fmt::print(" ");
     }
     fmt::print("\n");
-
-    INDENTED(fmt::print("Body:\n"));
-    IdentBlock([&]() { decl->body_->Accept(this); });
   }
 
  private:
@@ -139,6 +111,8 @@ class PrintVisitor : public Visitor {
   }
 
  private:
+  const lex::SourceTable& sources_;
+  ChildLabel labels_;
   size_t curr_tabs_ = 0;
 };
-}
\ No newline at end of file
+}
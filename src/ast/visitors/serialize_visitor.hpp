@@ -1,7 +1,8 @@
 #pragma once
 
 #include <fmt/core.h>
-#include <ast/visitors/visitor.hpp>
+#include <ast/visitors/base_visitor.hpp>
+#include <ast/visitors/child_label.hpp>
 #include <ast/expressions.hpp>
 
 #include <sstream>
@@ -13,171 +14,104 @@ namespace ast {
 
 #define INDENTED(stmt) { indent(); stmt; }
 
-class SerializeVisitor : public Visitor {
+class SerializeVisitor : public BaseVisitor {
  public:
-  template <typename Func>
-  void IdentBlock(Func fn) {
+  // Names and literals are decoded through `sources`
+  explicit SerializeVisitor(const lex::SourceTable& sources) : sources_{sources} {
+  }
+
+  void EnterChild(TreeNode* parent, size_t index) override {
+    std::string label = labels_.Get(parent, index);
+    if (!label.empty()) {
+      INDENTED(out_ << label << "\n");
+    }
     curr_tabs_++;
-    fn();
+  }
+
+  void LeaveChild(TreeNode*, size_t) override {
     curr_tabs_--;
   }
 
-  void VisitProgram(ast::Program* prg) override {
+  void EnterProgram(ast::Program*) override {
     INDENTED(out_ << fmt::format("Program\n"));
-    for (size_t i = 0; i < prg->decls_.size(); i++) {
-      INDENTED(out_ << fmt::format("Declaration {}:\n", i));
-      IdentBlock([&]() {
-        prg->decls_[i]->Accept(this);
-      });
-    }
   }
 
-  void VisitComparisonExpression(ast::ComparisonExpression* expr) override {
+  void EnterComparisonExpression(ast::ComparisonExpression* expr) override {
     INDENTED(out_ << fmt::format("Comparison: {}\n",
                                  lex::FormatTokenType(expr->operation_.type)));
-    INDENTED(out_ << fmt::format("LHS:\n"));
-    IdentBlock([&]() {
-      expr->lhs_->Accept(this);
-    });
-    INDENTED(out_ << fmt::format("RHS\n"));
-    IdentBlock([&]() {
-      expr->rhs_->Accept(this);
-    });
   }
 
-  void VisitBinaryExpression(ast::BinaryExpression* expr) override {
+  void EnterBinaryExpression(ast::BinaryExpression* expr) override {
     INDENTED(out_ << fmt::format("Binary expression: {}\n",
                                  lex::FormatTokenType(expr->operation_.type)));
-    INDENTED(out_ << fmt::format("LHS:\n"));
-    IdentBlock([&]() {
-      expr->lhs_->Accept(this);
-    });
-    INDENTED(out_ << fmt::format("RHS\n"));
-    IdentBlock([&]() {
-      expr->rhs_->Accept(this);
-    });
   }
 
-  void VisitUnaryExpression(ast::UnaryExpression* expr) override {
+  void EnterUnaryExpression(ast::UnaryExpression* expr) override {
     INDENTED(out_ << fmt::format("Unary expression: {}\n",
                                  lex::FormatTokenType(expr->operation_.type)));
-    INDENTED(out_ << fmt::format("Expression:\n"));
-    IdentBlock([&]() {
-      expr->expr_->Accept(this);
-    });
   }
 
-  void VisitIfExpression(ast::IfExpression* expr) override {
+  void EnterIfExpression(ast::IfExpression*) override {
     INDENTED(out_ << fmt::format("If\n"));
-    INDENTED(out_ << fmt::format("Condition:\n"));
-    IdentBlock([&]() {
-      expr->condition_->Accept(this);
-    });
-    INDENTED(out_ << fmt::format("Then branch:\n"));
-    IdentBlock([&]() {
-      expr->then_branch_->Accept(this);
-    });
-    if (expr->else_branch_ != nullptr) {
-      INDENTED(out_ << fmt::format("Else branch:\n"));
-      IdentBlock([&]() {
-        expr->else_branch_->Accept(this);
-      });
-    }
   }
 
-  void VisitBlockExpression(ast::BlockExpression* expr) override {
+  void EnterBlockExpression(ast::BlockExpression*) override {
     INDENTED(out_ << fmt::format("Block expression\n"));
-    for (size_t i = 0; i < expr->statements_.size(); i++) {
-      INDENTED(out_ << fmt::format("Statement {}:\n", i));
-      IdentBlock([&]() {
-        expr->statements_[i]->Accept(this);
-      });
-    }
   }
 
-  void VisitFnCallExpression(ast::FnCallExpression* expr) override {
+  void EnterFnCallExpression(ast::FnCallExpression*) override {
     INDENTED(out_ << fmt::format("Function call\n"));
-    INDENTED(out_ << fmt::format("Callable:\n"));
-    IdentBlock([&]() {
-      expr->callable_->Accept(this);
-    });
-    for (size_t i = 0; i < expr->args_.size(); i++) {
-      INDENTED(out_ << fmt::format("Arg {}:\n", i));
-      IdentBlock([&]() {
-        expr->args_[i]->Accept(this);
-      });
-    }
   }
 
-  void VisitLiteralExpression(ast::LiteralExpression* expr) override {
+  void EnterLiteralExpression(ast::LiteralExpression* expr) override {
     INDENTED(out_ << fmt::format("Literal expression: {}\n",
-                                 std::string{expr->literal_}));
+                                 expr->literal_.Format(sources_)));
   }
 
-  void VisitVarAccessExpression(ast::VarAccessExpression* expr) override {
+  void EnterVarAccessExpression(ast::VarAccessExpression* expr) override {
     INDENTED(
-        out_ << fmt::format("Var access: {}\n", expr->name_.GetIdentifier()));
+        out_ << fmt::format("Var access: {}\n", expr->name_.GetIdentifier(sources_)));
   }
 
-  void VisitReturnExpression(ast::ReturnExpression* expr) override {
+  void EnterReturnExpression(ast::ReturnExpression*) override {
     INDENTED(out_ << fmt::format("Return\n"));
-    INDENTED(out_ << fmt::format("Value (expression):\n"));
-    IdentBlock([&]() {
-      expr->expr_->Accept(this);
-    });
   }
 
-  void VisitYieldExpression(ast::YieldExpression* expr) override {
+  void EnterYieldExpression(ast::YieldExpression*) override {
     INDENTED(out_ << fmt::format("Yield\n"));
-    INDENTED(out_ << fmt::format("Value (expression):\n"));
-    IdentBlock([&]() {
-      expr->expr_->Accept(this);
-    });
   }
 
-  void VisitExprStatement(ast::ExprStatement* stmt) override {
+  void EnterExprStatement(ast::ExprStatement*) override {
     INDENTED(out_ << fmt::format("Expression statement\n"));
-    IdentBlock([&]() {
-      stmt->expr_->Accept(this);
-    });
   }
 
-  void VisitAssignmentStatement(ast::AssignmentStatement* stmt) override {
+  void EnterAssignmentStatement(ast::AssignmentStatement*) override {
     INDENTED(out_ << fmt::format("Assignment\n"));
-    INDENTED(out_ << fmt::format("Lvalue:\n"));
-    IdentBlock([&]() {
-      stmt->lhs_->Accept(this);
-    });
-    INDENTED(out_ << fmt::format("Assigned expression:\n"));
-    IdentBlock([&]() {
-      stmt->rhs_->Accept(this);
-    });
   }
 
-  void VisitVarDeclaration(ast::VarDeclStatement* decl) override {
+  void EnterErrorExpression(ast::ErrorExpression*) override {
+    INDENTED(out_ << fmt::format("Error expression\n"));
+  }
+
+  void EnterErrorStatement(ast::ErrorStatement*) override {
+    INDENTED(out_ << fmt::format("Error statement\n"));
+  }
+
+  void EnterVarDeclaration(ast::VarDeclStatement* decl) override {
     INDENTED(
-        out_ << fmt::format("Variable declaration: {}\n", decl->GetName()));
-    INDENTED(out_ << fmt::format("Initializer:\n"));
-    IdentBlock([&]() {
-      decl->init_expr_->Accept(this);
-    });
+        out_ << fmt::format("Variable declaration: {}\n", decl->GetName(sources_)));
   }
 
-  void VisitFunDeclaration(ast::FunDeclStatement* decl) override {
+  void EnterFunDeclaration(ast::FunDeclStatement* decl) override {
     INDENTED(
-        out_ << fmt::format("Function declaration: {}\n", decl->GetName()));
+        out_ << fmt::format("Function declaration: {}\n", decl->GetName(sources_)));
 
     INDENTED(out_ << fmt::format("Params: "));
     for (auto& param : decl->params_) {
-      out_ << fmt::format("{}", param.GetIdentifier());
+      out_ << fmt::format("{}", param.GetIdentifier(sources_));
       out_ << fmt::format(" ");
     }
     out_ << fmt::format("\n");
-
-    INDENTED(out_ << fmt::format("Body:\n"));
-    IdentBlock([&]() {
-      decl->body_->Accept(this);
-    });
   }
 
   std::string GetSerializedString() const {
@@ -192,7 +126,9 @@ class SerializeVisitor : public Visitor {
   }
 
  private:
+  const lex::SourceTable& sources_;
+  ChildLabel labels_;
   std::stringstream out_;
   size_t curr_tabs_ = 0;
 };
-} // namespace ast
\ No newline at end of file
+} // namespace ast
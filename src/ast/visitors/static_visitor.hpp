@@ -0,0 +1,418 @@
+#pragma once
+
+#include <ast/declarations.hpp>
+#include <ast/expressions.hpp>
+#include <ast/statements.hpp>
+#include <ast/visitors/visitor.hpp>
+
+#include <fmt/core.h>
+
+#include <vector>
+
+namespace ast {
+
+/// Walks a subtree with an explicit stack like BaseVisitor, but calls the
+/// hooks of `Derived` directly: nodes are dispatched with a switch over
+/// their kind, so the compiler sees and can inline the whole traversal.
+/// Derived hides the Enter*/Leave*/EnterChild/LeaveChild hooks it needs,
+/// by name, without `override`. Accept() on any node starts a walk, that
+/// is the only virtual call. Derived may hide Walk to wrap the traversal
+template <typename Derived>
+class StaticVisitor : public Visitor {
+ public:
+  void VisitProgram(Program* prg) final {
+    Self().Walk(prg);
+  }
+
+  void VisitComparisonExpression(ComparisonExpression* expr) final {
+    Self().Walk(expr);
+  }
+
+  void VisitBinaryExpression(BinaryExpression* expr) final {
+    Self().Walk(expr);
+  }
+
+  void VisitUnaryExpression(UnaryExpression* expr) final {
+    Self().Walk(expr);
+  }
+
+  void VisitIfExpression(IfExpression* expr) final {
+    Self().Walk(expr);
+  }
+
+  void VisitBlockExpression(BlockExpression* expr) final {
+    Self().Walk(expr);
+  }
+
+  void VisitFnCallExpression(FnCallExpression* expr) final {
+    Self().Walk(expr);
+  }
+
+  void VisitLiteralExpression(LiteralExpression* expr) final {
+    Self().Walk(expr);
+  }
+
+  void VisitVarAccessExpression(VarAccessExpression* expr) final {
+    Self().Walk(expr);
+  }
+
+  void VisitYieldExpression(YieldExpression* expr) final {
+    Self().Walk(expr);
+  }
+
+  void VisitReturnExpression(ReturnExpression* expr) final {
+    Self().Walk(expr);
+  }
+
+  void VisitErrorExpression(ErrorExpression* expr) final {
+    Self().Walk(expr);
+  }
+
+  void VisitExprStatement(ExprStatement* stmt) final {
+    Self().Walk(stmt);
+  }
+
+  void VisitAssignmentStatement(AssignmentStatement* stmt) final {
+    Self().Walk(stmt);
+  }
+
+  void VisitErrorStatement(ErrorStatement* stmt) final {
+    Self().Walk(stmt);
+  }
+
+  void VisitVarDeclaration(VarDeclStatement* decl) final {
+    Self().Walk(decl);
+  }
+
+  void VisitFunDeclaration(FunDeclStatement* decl) final {
+    Self().Walk(decl);
+  }
+
+  ////////////////////////////////////////////////////////////////////
+
+  void EnterProgram(Program*) {}
+  void LeaveProgram(Program*) {}
+
+  void EnterComparisonExpression(ComparisonExpression*) {}
+  void LeaveComparisonExpression(ComparisonExpression*) {}
+
+  void EnterBinaryExpression(BinaryExpression*) {}
+  void LeaveBinaryExpression(BinaryExpression*) {}
+
+  void EnterUnaryExpression(UnaryExpression*) {}
+  void LeaveUnaryExpression(UnaryExpression*) {}
+
+  void EnterIfExpression(IfExpression*) {}
+  void LeaveIfExpression(IfExpression*) {}
+
+  void EnterBlockExpression(BlockExpression*) {}
+  void LeaveBlockExpression(BlockExpression*) {}
+
+  void EnterFnCallExpression(FnCallExpression*) {}
+  void LeaveFnCallExpression(FnCallExpression*) {}
+
+  void EnterLiteralExpression(LiteralExpression*) {}
+  void LeaveLiteralExpression(LiteralExpression*) {}
+
+  void EnterVarAccessExpression(VarAccessExpression*) {}
+  void LeaveVarAccessExpression(VarAccessExpression*) {}
+
+  void EnterYieldExpression(YieldExpression*) {}
+  void LeaveYieldExpression(YieldExpression*) {}
+
+  void EnterReturnExpression(ReturnExpression*) {}
+  void LeaveReturnExpression(ReturnExpression*) {}
+
+  // Nothing was parsed here, passes usually skip it
+  void EnterErrorExpression(ErrorExpression*) {}
+  void LeaveErrorExpression(ErrorExpression*) {}
+
+  void EnterExprStatement(ExprStatement*) {}
+  void LeaveExprStatement(ExprStatement*) {}
+
+  void EnterAssignmentStatement(AssignmentStatement*) {}
+  void LeaveAssignmentStatement(AssignmentStatement*) {}
+
+  void EnterErrorStatement(ErrorStatement*) {}
+  void LeaveErrorStatement(ErrorStatement*) {}
+
+  void EnterVarDeclaration(VarDeclStatement*) {}
+  void LeaveVarDeclaration(VarDeclStatement*) {}
+
+  void EnterFunDeclaration(FunDeclStatement*) {}
+  void LeaveFunDeclaration(FunDeclStatement*) {}
+
+  // Around the walk of each child, numbered from 0 in source order.
+  // A missing else branch is not counted
+  void EnterChild(TreeNode* /* parent */, size_t /* index */) {}
+  void LeaveChild(TreeNode* /* parent */, size_t /* index */) {}
+
+  ////////////////////////////////////////////////////////////////////
+
+  void Walk(TreeNode* root) {
+    std::vector<Frame> frames;
+
+    Enter(root);
+    frames.push_back(Frame{root, 0});
+
+    while (!frames.empty()) {
+      Frame& frame = frames.back();
+
+      if (TreeNode* child = GetChild(frame.node, frame.next_child)) {
+        Self().EnterChild(frame.node, frame.next_child++);
+        Enter(child);
+        frames.push_back(Frame{child, 0});
+        continue;
+      }
+
+      TreeNode* node = frame.node;
+      frames.pop_back();
+      Leave(node);
+
+      if (!frames.empty()) {
+        Frame& parent = frames.back();
+        Self().LeaveChild(parent.node, parent.next_child - 1);
+      }
+    }
+  }
+
+ private:
+  struct Frame {
+    TreeNode* node;
+    size_t next_child;
+  };
+
+  Derived& Self() {
+    return static_cast<Derived&>(*this);
+  }
+
+  // Child `index` of `node` in source order, null past the last one
+  static TreeNode* GetChild(TreeNode* node, size_t index) {
+    auto at = [index](auto& items) -> TreeNode* {
+      return index < items.size() ? items[index] : nullptr;
+    };
+
+    switch (node->GetKind()) {
+      case NodeKind::Program:
+        return at(static_cast<Program*>(node)->decls_);
+
+      case NodeKind::Comparison: {
+        auto expr = static_cast<ComparisonExpression*>(node);
+        return index == 0 ? expr->lhs_ : index == 1 ? expr->rhs_ : nullptr;
+      }
+
+      case NodeKind::Binary: {
+        auto expr = static_cast<BinaryExpression*>(node);
+        return index == 0 ? expr->lhs_ : index == 1 ? expr->rhs_ : nullptr;
+      }
+
+      case NodeKind::Unary:
+        return index == 0 ? static_cast<UnaryExpression*>(node)->expr_ : nullptr;
+
+      case NodeKind::If: {
+        // A missing else branch ends the list
+        auto expr = static_cast<IfExpression*>(node);
+        switch (index) {
+          case 0:
+            return expr->condition_;
+          case 1:
+            return expr->then_branch_;
+          case 2:
+            return expr->else_branch_;
+          default:
+            return nullptr;
+        }
+      }
+
+      case NodeKind::Block:
+        return at(static_cast<BlockExpression*>(node)->statements_);
+
+      case NodeKind::FnCall: {
+        auto expr = static_cast<FnCallExpression*>(node);
+        return index == 0 ? expr->callable_ : index <= expr->args_.size() ? expr->args_[index - 1] : nullptr;
+      }
+
+      case NodeKind::Yield:
+        return index == 0 ? static_cast<YieldExpression*>(node)->expr_ : nullptr;
+
+      case NodeKind::Return:
+        return index == 0 ? static_cast<ReturnExpression*>(node)->expr_ : nullptr;
+
+      case NodeKind::ExprStatement:
+        return index == 0 ? static_cast<ExprStatement*>(node)->expr_ : nullptr;
+
+      case NodeKind::Assignment: {
+        auto stmt = static_cast<AssignmentStatement*>(node);
+        return index == 0 ? stmt->lhs_ : index == 1 ? stmt->rhs_ : nullptr;
+      }
+
+      case NodeKind::VarDecl:
+        return index == 0 ? static_cast<VarDeclStatement*>(node)->init_expr_ : nullptr;
+
+      case NodeKind::FunDecl:
+        return index == 0 ? static_cast<FunDeclStatement*>(node)->GetBody() : nullptr;
+
+      case NodeKind::Literal:
+      case NodeKind::VarAccess:
+      case NodeKind::ErrorExpression:
+      case NodeKind::ErrorStatement:
+      case NodeKind::Param:
+        return nullptr;
+    }
+
+    return nullptr;
+  }
+
+  // Runs the Enter hook of a node
+  void Enter(TreeNode* node) {
+    switch (node->GetKind()) {
+      case NodeKind::Program:
+        Self().EnterProgram(static_cast<Program*>(node));
+        break;
+
+      case NodeKind::Comparison:
+        Self().EnterComparisonExpression(static_cast<ComparisonExpression*>(node));
+        break;
+
+      case NodeKind::Binary:
+        Self().EnterBinaryExpression(static_cast<BinaryExpression*>(node));
+        break;
+
+      case NodeKind::Unary:
+        Self().EnterUnaryExpression(static_cast<UnaryExpression*>(node));
+        break;
+
+      case NodeKind::If:
+        Self().EnterIfExpression(static_cast<IfExpression*>(node));
+        break;
+
+      case NodeKind::Block:
+        Self().EnterBlockExpression(static_cast<BlockExpression*>(node));
+        break;
+
+      case NodeKind::FnCall:
+        Self().EnterFnCallExpression(static_cast<FnCallExpression*>(node));
+        break;
+
+      case NodeKind::Literal:
+        Self().EnterLiteralExpression(static_cast<LiteralExpression*>(node));
+        break;
+
+      case NodeKind::VarAccess:
+        Self().EnterVarAccessExpression(static_cast<VarAccessExpression*>(node));
+        break;
+
+      case NodeKind::Yield:
+        Self().EnterYieldExpression(static_cast<YieldExpression*>(node));
+        break;
+
+      case NodeKind::Return:
+        Self().EnterReturnExpression(static_cast<ReturnExpression*>(node));
+        break;
+
+      case NodeKind::ErrorExpression:
+        Self().EnterErrorExpression(static_cast<ErrorExpression*>(node));
+        break;
+
+      case NodeKind::ExprStatement:
+        Self().EnterExprStatement(static_cast<ExprStatement*>(node));
+        break;
+
+      case NodeKind::Assignment:
+        Self().EnterAssignmentStatement(static_cast<AssignmentStatement*>(node));
+        break;
+
+      case NodeKind::ErrorStatement:
+        Self().EnterErrorStatement(static_cast<ErrorStatement*>(node));
+        break;
+
+      case NodeKind::VarDecl:
+        Self().EnterVarDeclaration(static_cast<VarDeclStatement*>(node));
+        break;
+
+      case NodeKind::FunDecl:
+        Self().EnterFunDeclaration(static_cast<FunDeclStatement*>(node));
+        break;
+
+      case NodeKind::Param:
+        FMT_ASSERT(false, "Parameters are not tree nodes\n");
+    }
+  }
+
+  // Runs the Leave hook of a node
+  void Leave(TreeNode* node) {
+    switch (node->GetKind()) {
+      case NodeKind::Program:
+        Self().LeaveProgram(static_cast<Program*>(node));
+        break;
+
+      case NodeKind::Comparison:
+        Self().LeaveComparisonExpression(static_cast<ComparisonExpression*>(node));
+        break;
+
+      case NodeKind::Binary:
+        Self().LeaveBinaryExpression(static_cast<BinaryExpression*>(node));
+        break;
+
+      case NodeKind::Unary:
+        Self().LeaveUnaryExpression(static_cast<UnaryExpression*>(node));
+        break;
+
+      case NodeKind::If:
+        Self().LeaveIfExpression(static_cast<IfExpression*>(node));
+        break;
+
+      case NodeKind::Block:
+        Self().LeaveBlockExpression(static_cast<BlockExpression*>(node));
+        break;
+
+      case NodeKind::FnCall:
+        Self().LeaveFnCallExpression(static_cast<FnCallExpression*>(node));
+        break;
+
+      case NodeKind::Literal:
+        Self().LeaveLiteralExpression(static_cast<LiteralExpression*>(node));
+        break;
+
+      case NodeKind::VarAccess:
+        Self().LeaveVarAccessExpression(static_cast<VarAccessExpression*>(node));
+        break;
+
+      case NodeKind::Yield:
+        Self().LeaveYieldExpression(static_cast<YieldExpression*>(node));
+        break;
+
+      case NodeKind::Return:
+        Self().LeaveReturnExpression(static_cast<ReturnExpression*>(node));
+        break;
+
+      case NodeKind::ErrorExpression:
+        Self().LeaveErrorExpression(static_cast<ErrorExpression*>(node));
+        break;
+
+      case NodeKind::ExprStatement:
+        Self().LeaveExprStatement(static_cast<ExprStatement*>(node));
+        break;
+
+      case NodeKind::Assignment:
+        Self().LeaveAssignmentStatement(static_cast<AssignmentStatement*>(node));
+        break;
+
+      case NodeKind::ErrorStatement:
+        Self().LeaveErrorStatement(static_cast<ErrorStatement*>(node));
+        break;
+
+      case NodeKind::VarDecl:
+        Self().LeaveVarDeclaration(static_cast<VarDeclStatement*>(node));
+        break;
+
+      case NodeKind::FunDecl:
+        Self().LeaveFunDeclaration(static_cast<FunDeclStatement*>(node));
+        break;
+
+      case NodeKind::Param:
+        FMT_ASSERT(false, "Parameters are not tree nodes\n");
+    }
+  }
+};
+} // namespace ast
@@ -27,6 +27,7 @@ class VarAccessExpression;
 class TypecastExpression;
 class YieldExpression;
 class ReturnExpression;
+class ErrorExpression;
 
 //////////////////////////////////////////////////////////////////////
 
@@ -35,6 +36,7 @@ class ExprStatement;
 class AssignmentStatement;
 class VarDeclStatement;
 class FunDeclStatement;
+class ErrorStatement;
 
 //////////////////////////////////////////////////////////////////////
 
@@ -76,11 +78,13 @@ class Visitor {
   //  virtual void VisitTypecastExpression(TypecastExpression *expr) = 0;
   virtual void VisitYieldExpression(YieldExpression *expr) = 0;
   virtual void VisitReturnExpression(ReturnExpression *expr) = 0;
+  virtual void VisitErrorExpression(ErrorExpression *expr) = 0;
 
   //////////////////////////////////////////////////////////////////////
 
   virtual void VisitExprStatement(ExprStatement* stmt) = 0;
   virtual void VisitAssignmentStatement(AssignmentStatement* stmt) = 0;
+  virtual void VisitErrorStatement(ErrorStatement* stmt) = 0;
 
   //////////////////////////////////////////////////////////////////////
 
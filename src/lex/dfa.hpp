@@ -0,0 +1,252 @@
+#pragma once
+
+#include <lex/token_type.hpp>
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+namespace lex::dfa {
+
+//////////////////////////////////////////////////////////////////////
+
+// Table-driven recognizer for a single token, generated at compile time.
+// Operators are taken from the spellings of TokenType, words, numbers and
+// strings are fixed states. Keywords are classified after the fact by
+// IdentTable, just like in the branching lexer.
+
+using State = uint8_t;
+
+inline constexpr size_t kMaxStates = 32;
+inline constexpr size_t kMaxClasses = 32;
+
+// Fixed states, operator trie states follow
+inline constexpr State kDead = 0;
+inline constexpr State kStart = 1;
+inline constexpr State kWord = 2;
+inline constexpr State kNumber = 3;
+inline constexpr State kStringBody = 4;
+inline constexpr State kStringEnd = 5;
+inline constexpr State kFirstOperator = 6;
+
+//////////////////////////////////////////////////////////////////////
+
+constexpr bool IsAlpha(char ch) {
+  return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z');
+}
+
+constexpr bool IsDigit(char ch) {
+  return ch >= '0' && ch <= '9';
+}
+
+constexpr bool IsWordTail(char ch) {
+  return IsAlpha(ch) || IsDigit(ch) || ch == '_' || ch == '-';
+}
+
+// Operator tokens are the ones spelled without letters and digits
+constexpr bool IsOperator(TokenType type) {
+  std::string_view spelling = FormatTokenType(type);
+  for (char ch : spelling) {
+    if (IsAlpha(ch) || IsDigit(ch)) {
+      return false;
+    }
+  }
+
+  return !spelling.empty();
+}
+
+//////////////////////////////////////////////////////////////////////
+
+struct Tables {
+  std::array<uint8_t, 256> char_class{};
+  std::array<std::array<State, kMaxClasses>, kMaxStates> transitions{};
+  std::array<TokenType, kMaxStates> accepts{};
+  size_t class_count = 0;
+  size_t state_count = 0;
+};
+
+namespace detail {
+
+struct OperatorTrie {
+  // Spelling prefix recognized by each operator state
+  std::array<std::string_view, kMaxStates> prefixes{};
+  std::array<TokenType, kMaxStates> accepts{};
+  size_t state_count = kFirstOperator;
+
+  constexpr State Find(std::string_view prefix) const {
+    for (size_t state = kFirstOperator; state < state_count; state++) {
+      if (prefixes[state] == prefix) {
+        return static_cast<State>(state);
+      }
+    }
+
+    return kDead;
+  }
+};
+
+constexpr OperatorTrie BuildOperatorTrie() {
+  OperatorTrie trie;
+  for (auto& accept : trie.accepts) {
+    accept = TokenType::DUMMY;
+  }
+
+  for (int index = 0; index <= static_cast<int>(TokenType::TOKEN_EOF); index++) {
+    auto type = static_cast<TokenType>(index);
+    if (!IsOperator(type)) {
+      continue;
+    }
+
+    std::string_view spelling = FormatTokenType(type);
+    for (size_t len = 1; len <= spelling.size(); len++) {
+      std::string_view prefix = spelling.substr(0, len);
+      State state = trie.Find(prefix);
+      if (state == kDead) {
+        state = static_cast<State>(trie.state_count++);
+        trie.prefixes[state] = prefix;
+      }
+
+      if (len == spelling.size()) {
+        trie.accepts[state] = type;
+      }
+    }
+  }
+
+  return trie;
+}
+
+constexpr bool IsOperatorChar(const OperatorTrie& trie, char ch) {
+  for (size_t state = kFirstOperator; state < trie.state_count; state++) {
+    if (trie.prefixes[state].find(ch) != std::string_view::npos) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// Byte-level transition function, tables are just its compressed form
+constexpr State Step(const OperatorTrie& trie, State state, char ch) {
+  switch (state) {
+    case kStart:
+      if (IsAlpha(ch)) {
+        return kWord;
+      }
+      if (IsDigit(ch)) {
+        return kNumber;
+      }
+      if (ch == '"') {
+        return kStringBody;
+      }
+      return trie.Find(std::string_view(&ch, 1));
+
+    case kWord:
+      return IsWordTail(ch) ? kWord : kDead;
+
+    case kNumber:
+      return IsDigit(ch) ? kNumber : kDead;
+
+    case kStringBody:
+      return ch == '"' ? kStringEnd : kStringBody;
+
+    case kStringEnd:
+    case kDead:
+      return kDead;
+
+    default: {
+      // Extend operator prefix by one char
+      std::string_view prefix = trie.prefixes[state];
+      for (size_t next = kFirstOperator; next < trie.state_count; next++) {
+        std::string_view candidate = trie.prefixes[next];
+        if (candidate.size() == prefix.size() + 1 &&
+            candidate.substr(0, prefix.size()) == prefix &&
+            candidate.back() == ch) {
+          return static_cast<State>(next);
+        }
+      }
+      return kDead;
+    }
+  }
+}
+
+}  // namespace detail
+
+//////////////////////////////////////////////////////////////////////
+
+constexpr Tables BuildTables() {
+  detail::OperatorTrie trie = detail::BuildOperatorTrie();
+  Tables tables;
+
+  // Bytes which behave identically share a class: letters, digits, each
+  // operator char on its own, word tail chars, quote and everything else
+  std::array<char, kMaxClasses> representative{};
+  tables.class_count = 0;
+  auto new_class = [&](char ch) {
+    representative[tables.class_count] = ch;
+    return static_cast<uint8_t>(tables.class_count++);
+  };
+
+  uint8_t other_class = new_class('\0');
+  uint8_t alpha_class = new_class('a');
+  uint8_t digit_class = new_class('0');
+  uint8_t quote_class = new_class('"');
+
+  for (int byte = 0; byte < 256; byte++) {
+    char ch = static_cast<char>(byte);
+    if (IsAlpha(ch)) {
+      tables.char_class[byte] = alpha_class;
+    } else if (IsDigit(ch)) {
+      tables.char_class[byte] = digit_class;
+    } else if (ch == '"') {
+      tables.char_class[byte] = quote_class;
+    } else if (detail::IsOperatorChar(trie, ch) || IsWordTail(ch)) {
+      tables.char_class[byte] = new_class(ch);
+    } else {
+      tables.char_class[byte] = other_class;
+    }
+  }
+
+  tables.state_count = trie.state_count;
+  for (size_t state = 0; state < tables.state_count; state++) {
+    for (size_t cls = 0; cls < tables.class_count; cls++) {
+      tables.transitions[state][cls] =
+          detail::Step(trie, static_cast<State>(state), representative[cls]);
+    }
+    tables.accepts[state] = trie.accepts[state];
+  }
+
+  tables.accepts[kWord] = TokenType::IDENTIFIER;
+  tables.accepts[kNumber] = TokenType::NUMBER;
+  tables.accepts[kStringEnd] = TokenType::STRING;
+
+  return tables;
+}
+
+inline constexpr Tables kTables = BuildTables();
+
+static_assert(kTables.state_count <= kMaxStates, "Too many DFA states");
+static_assert(kTables.class_count <= kMaxClasses, "Too many char classes");
+
+//////////////////////////////////////////////////////////////////////
+
+/// Runs the automaton from the start of `text` as far as possible,
+/// returns the last state reached and stores consumed length in `length`
+inline State Run(std::string_view text, size_t& length) {
+  State state = kStart;
+  size_t pos = 0;
+  while (pos < text.size()) {
+    State next = kTables.transitions[state][kTables.char_class[static_cast<uint8_t>(text[pos])]];
+    if (next == kDead) {
+      break;
+    }
+
+    state = next;
+    pos++;
+  }
+
+  length = pos;
+  return state;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+}  // namespace lex::dfa
@@ -2,56 +2,154 @@
 
 #include <lex/token_type.hpp>
 
+#include <array>
+#include <cstdint>
+#include <deque>
 #include <string>
-#include <map>
-
-#include <fmt/core.h>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
 namespace lex {
+
+// Dense id of an interned identifier
+using SymbolId = uint32_t;
+
+namespace detail {
+
+// Keywords are the tokens spelled with letters only
+constexpr bool IsKeyword(TokenType type) {
+  std::string_view spelling = FormatTokenType(type);
+  for (char ch : spelling) {
+    if (!((ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z'))) {
+      return false;
+    }
+  }
+
+  return !spelling.empty();
+}
+
+// Perfect hash over the keyword set: every keyword lands in its own
+// slot, so a lookup is one hash and at most one string compare
+struct KeywordTable {
+  static constexpr size_t kSlots = 32;
+
+  struct Slot {
+    std::string_view word;
+    TokenType type = TokenType::IDENTIFIER;
+  };
+
+  uint32_t first_mul = 0;
+  uint32_t last_mul = 0;
+  std::array<Slot, kSlots> slots{};
+
+  constexpr size_t Hash(std::string_view word) const {
+    auto first = static_cast<unsigned char>(word.front());
+    auto last = static_cast<unsigned char>(word.back());
+    return (first * first_mul + last * last_mul + word.size()) & (kSlots - 1);
+  }
+
+  // Tries to place every keyword with the current multipliers
+  constexpr bool TryPopulate() {
+    slots = {};
+    for (int index = 0; index <= static_cast<int>(TokenType::TOKEN_EOF); index++) {
+      auto type = static_cast<TokenType>(index);
+      if (!IsKeyword(type)) {
+        continue;
+      }
+
+      std::string_view word = FormatTokenType(type);
+      Slot& slot = slots[Hash(word)];
+      if (!slot.word.empty()) {
+        return false;
+      }
+
+      slot = Slot{word, type};
+    }
+
+    return true;
+  }
+};
+
+constexpr KeywordTable BuildKeywordTable() {
+  KeywordTable table;
+  for (uint32_t first_mul = 1; first_mul < 64; first_mul++) {
+    for (uint32_t last_mul = 0; last_mul < 64; last_mul++) {
+      table.first_mul = first_mul;
+      table.last_mul = last_mul;
+      if (table.TryPopulate()) {
+        return table;
+      }
+    }
+  }
+
+  // No collision-free multipliers, bump kSlots
+  table.first_mul = 0;
+  return table;
+}
+
+inline constexpr KeywordTable kKeywords = BuildKeywordTable();
+static_assert(kKeywords.first_mul != 0, "Could not build keyword perfect hash");
+
+}  // namespace detail
+
+//////////////////////////////////////////////////////////////////////
+
+/// Keyword classification and identifier interning. One table may be
+/// shared by several Lexers, interned names live as long as the table
 class IdentTable {
  public:
-  IdentTable() {
-    Populate();
-  }
+  IdentTable() = default;
 
-  // Use-of-string-view-for-map-lookup
-  // https://stackoverflow.com/questions/35525777
+  // Source tables and lexers refer to the table by address
+  IdentTable(const IdentTable&) = delete;
+  IdentTable& operator=(const IdentTable&) = delete;
+
+  static constexpr TokenType LookupWord(const std::string_view word) {
+    if (word.empty()) {
+      return TokenType::IDENTIFIER;
+    }
 
-  TokenType LookupWord(const std::string_view word) {
-    auto iter = map_.find(word);
-    if (iter == map_.end()) {
+    const auto& slot = detail::kKeywords.slots[detail::kKeywords.Hash(word)];
+    if (slot.word != word) {
       // Word is identifier if not some keyword
       return TokenType::IDENTIFIER;
     }
 
-    return iter->second;
+    return slot.type;
   }
 
- private:
-  void Populate() {
-    map_["true"] = TokenType::TRUE;
-    map_["false"] = TokenType::FALSE;
-    map_["fun"] = TokenType::FUN;
-    map_["var"] = TokenType::VAR;
-    map_["if"] = TokenType::IF;
-    map_["then"] = TokenType::THEN;
-    map_["else"] = TokenType::ELSE;
-    map_["for"] = TokenType::FOR;
-    map_["return"] = TokenType::RETURN;
-    map_["yield"] = TokenType::YIELD;
-    map_["of"] = TokenType::OF;
-
-    map_["Int"] = TokenType::TY_INT;
-    map_["Bool"] = TokenType::TY_BOOL;
-    map_["String"] = TokenType::TY_STRING;
-    map_["Unit"] = TokenType::TY_UNIT;
+  SymbolId Intern(std::string_view word) {
+    auto iter = ids_.find(word);
+    if (iter != ids_.end()) {
+      return iter->second;
+    }
+
+    // Own a copy, so names outlive the source buffer. Deque never moves
+    // its elements, so views into them stay valid
+    std::string_view name = storage_.emplace_back(word);
+    auto id = static_cast<SymbolId>(names_.size());
+    names_.push_back(name);
+    ids_.emplace(name, id);
+    return id;
   }
 
- private:
-  // What-are-transparent-comparators
-  // https://stackoverflow.com/questions/20317413
+  std::string_view GetName(SymbolId id) const {
+    return names_[id];
+  }
+
+  size_t Size() const {
+    return names_.size();
+  }
 
-  std::map<std::string, TokenType, std::less<>> map_;
+ private:
+  std::deque<std::string> storage_;
+  std::vector<std::string_view> names_;
+  std::unordered_map<std::string_view, SymbolId> ids_;
 };
 
+static_assert(IdentTable::LookupWord("return") == TokenType::RETURN);
+static_assert(IdentTable::LookupWord("String") == TokenType::TY_STRING);
+static_assert(IdentTable::LookupWord("returns") == TokenType::IDENTIFIER);
+
 }  // namespace lex
@@ -1,8 +1,58 @@
 #include <lex/lexer.hpp>
+#include <lex/dfa.hpp>
+
+#include <algorithm>
 
 namespace lex {
 
-Lexer::Lexer(std::istream& source) : scanner_{source} {
+Lexer::Lexer(std::istream& source, LexerMode mode, size_t buffer_size)
+    : own_idents_{std::in_place},
+      idents_{&*own_idents_},
+      own_sources_{std::in_place, *idents_},
+      own_source_{std::in_place, *own_sources_},
+      source_{&*own_source_},
+      scanner_{source, *own_source_, buffer_size},
+      mode_{mode} {
+  Advance();
+}
+
+Lexer::Lexer(std::istream& source, SourceTable& sources, LexerMode mode,
+             size_t buffer_size)
+    : idents_{&sources.GetIdents()},
+      own_source_{std::in_place, sources},
+      source_{&*own_source_},
+      scanner_{source, *own_source_, buffer_size},
+      mode_{mode} {
+  Advance();
+}
+
+Lexer::Lexer(std::string_view source, LexerMode mode)
+    : own_idents_{std::in_place},
+      idents_{&*own_idents_},
+      own_sources_{std::in_place, *idents_},
+      own_source_{std::in_place, source, *own_sources_},
+      source_{&*own_source_},
+      scanner_{source},
+      mode_{mode} {
+  Advance();
+}
+
+Lexer::Lexer(std::string_view source, SourceTable& sources, LexerMode mode)
+    : idents_{&sources.GetIdents()},
+      own_source_{std::in_place, source, sources},
+      source_{&*own_source_},
+      scanner_{source},
+      mode_{mode} {
+  Advance();
+}
+
+Lexer::Lexer(const SourceFile& source, size_t start, IdentTable& idents,
+             bool speculative)
+    : idents_{&idents},
+      source_{&source},
+      scanner_{source.GetText(), start},
+      mode_{LexerMode::TableDriven},
+      speculative_{speculative} {
   Advance();
 }
 
@@ -11,6 +61,11 @@ Lexer::Lexer(std::istream& source) : scanner_{source} {
 Token Lexer::GetNextToken() {
   SkipWhitespace();
   SkipComments();
+  scanner_.MarkTokenStart();
+
+  if (mode_ == LexerMode::TableDriven) {
+    return MatchTableDriven();
+  }
 
   if (auto op = MatchOperators()) {
     return *op;
@@ -29,6 +84,12 @@ Token Lexer::GetNextToken() {
 
 ////////////////////////////////////////////////////////////////////
 
+Location Lexer::CurrentLocation() const {
+  return Location(static_cast<uint32_t>(scanner_.GetPosition()), source_->GetId());
+}
+
+////////////////////////////////////////////////////////////////////
+
 Token Lexer::GetPreviousToken() {
   return prev_;
 }
@@ -43,7 +104,7 @@ void Lexer::Advance() {
 ////////////////////////////////////////////////////////////////////
 
 bool Lexer::Matches(lex::TokenType type) {
-  if (Peek().type == type) {
+  if (peek_.type == type) {
     Advance();
     return true;
   }
@@ -59,14 +120,8 @@ Token Lexer::Peek() {
 
 ////////////////////////////////////////////////////////////////////
 
-bool IsWhitespace(char ch) {
-  return ch == ' ' || ch == '\n' || ch == '\t';
-}
-
 void Lexer::SkipWhitespace() {
-  while (IsWhitespace(scanner_.CurrentSymbol())) {
-    scanner_.MoveNext();
-  }
+  scanner_.SkipWhitespace();
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -80,9 +135,73 @@ void Lexer::SkipComments() {
 
 ////////////////////////////////////////////////////////////////////
 
+Token Lexer::MatchTableDriven() {
+  Location start_loc = CurrentLocation();
+  std::string_view rest = scanner_.GetRest();
+  if (rest.empty()) {
+    return Token(TokenType::TOKEN_EOF, start_loc);
+  }
+
+  size_t length = 0;
+  dfa::State state = dfa::Run(rest, length);
+  // A token reaching the end of a streaming window may go on past it
+  while (length == rest.size() && scanner_.Refill()) {
+    rest = scanner_.GetRest();
+    state = dfa::Run(rest, length);
+  }
+
+  // Moving invalidates the lexeme when streaming, so tokens are made first
+  std::string_view lexeme = rest.substr(0, length);
+
+  switch (TokenType type = dfa::kTables.accepts[state]) {
+    case TokenType::IDENTIFIER: {
+      Token word = MakeWordToken(lexeme, start_loc);
+      scanner_.MoveForward(length);
+      return word;
+    }
+
+    case TokenType::NUMBER: {
+      int literal = 0;
+      for (char digit : lexeme) {
+        literal *= 10;
+        literal += digit - '0';
+      }
+      scanner_.MoveForward(length);
+      return Token(TokenType::NUMBER, start_loc, static_cast<uint32_t>(literal));
+    }
+
+    case TokenType::STRING: {
+      // Same slice as MatchStringLiteral: without the closing quote
+      Token str = MakeStringToken(lexeme.substr(0, length - 1), start_loc);
+      // String literals may span several lines
+      scanner_.MoveForward(length);
+      return str;
+    }
+
+    case TokenType::DUMMY:
+      if (speculative_) {
+        // Covers what was scanned: the rest of an unterminated string, or
+        // else at least the offending byte, so lexing can go on past it
+        scanner_.MoveForward(std::max<size_t>(length, 1));
+        return Token(TokenType::DUMMY, start_loc);
+      }
+      if (state == dfa::kStringBody) {
+        FMT_ASSERT(false, "Unexpected end of the string literal");
+      }
+      FMT_ASSERT(false, "Could not match any token\n");
+
+    default:
+      // Operator
+      scanner_.MoveForward(length);
+      return Token(type, start_loc);
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+
 std::optional<Token> Lexer::MatchOperators() {
   // Save location first
-  Location location = scanner_.GetLocation();
+  Location location = CurrentLocation();
   auto op_type = PeekOperator();
   if (op_type.has_value()) {
     // All operators are single-symbol except != and ==
@@ -198,7 +317,7 @@ std::optional<Token> Lexer::MatchNumericLiteral() {
     return std::nullopt;
   }
 
-  Location start_loc = scanner_.GetLocation();
+  Location start_loc = CurrentLocation();
 
   int literal = 0;
   while (isdigit(scanner_.CurrentSymbol())) {
@@ -207,13 +326,13 @@ std::optional<Token> Lexer::MatchNumericLiteral() {
     scanner_.MoveNext();
   }
 
-  return Token(TokenType::NUMBER, start_loc, literal);
+  return Token(TokenType::NUMBER, start_loc, static_cast<uint32_t>(literal));
 }
 
 ////////////////////////////////////////////////////////////////////
 
 std::optional<Token> Lexer::MatchStringLiteral() {
-  Location start_loc = scanner_.GetLocation();
+  Location start_loc = CurrentLocation();
   if (scanner_.CurrentSymbol() != '"') {
     return std::nullopt;
   }
@@ -226,10 +345,10 @@ std::optional<Token> Lexer::MatchStringLiteral() {
   if (scanner_.CurrentSymbol() == EOF) {
     FMT_ASSERT(false, "Unexpected end of the string literal");
   } else {
-    Location end_loc = scanner_.GetLocation();
+    Token str = MakeStringToken(
+        scanner_.GetSlice(start_loc.abs_pos, scanner_.GetPosition()), start_loc);
     scanner_.MoveNext();
-    return Token(TokenType::STRING, start_loc,
-                 scanner_.GetSlice(start_loc, end_loc));
+    return str;
   }
 }
 
@@ -241,7 +360,7 @@ std::optional<Token> Lexer::MatchWords() {
     return std::nullopt;
   }
 
-  Location start_loc = scanner_.GetLocation();
+  Location start_loc = CurrentLocation();
 
   scanner_.MoveNext();
   MoveNextWhileCond([&]() {
@@ -251,13 +370,33 @@ std::optional<Token> Lexer::MatchWords() {
            scanner_.CurrentSymbol() == '-';
   });
 
-  Location end_loc = scanner_.GetLocation();
-  std::string_view word = scanner_.GetSlice(start_loc, end_loc);
+  std::string_view word =
+      scanner_.GetSlice(start_loc.abs_pos, scanner_.GetPosition());
+  return MakeWordToken(word, start_loc);
+}
 
+////////////////////////////////////////////////////////////////////
+
+Token Lexer::MakeWordToken(std::string_view word, Location location) {
   // The word would be a keyword if it matches with some template, and
   // identifier otherwise
-  TokenType word_type = table_.LookupWord(word);
-  return Token(word_type, start_loc, word);
+  TokenType word_type = IdentTable::LookupWord(word);
+  if (word_type != TokenType::IDENTIFIER) {
+    return Token(word_type, location);
+  }
+
+  return Token(word_type, location, idents_->Intern(word));
+}
+
+////////////////////////////////////////////////////////////////////
+
+Token Lexer::MakeStringToken(std::string_view text, Location location) {
+  if (own_source_.has_value() && own_source_->IsStreamed()) {
+    // The scanner window is about to be reused
+    return Token(TokenType::STRING, location, own_source_->AddLiteral(text));
+  }
+
+  return Token(TokenType::STRING, location, static_cast<uint32_t>(text.size()));
 }
 
 }  // namespace lex
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <lex/ident_table.hpp>
+#include <lex/source_file.hpp>
 #include <lex/token.hpp>
 
 #include <fmt/format.h>
@@ -10,14 +11,63 @@
 
 namespace lex {
 
+enum class LexerMode {
+  // Compile-time generated DFA, see lex/dfa.hpp
+  TableDriven,
+  // Hand-written matchers, kept as the reference implementation
+  Branching,
+};
+
 class Lexer {
  public:
-  explicit Lexer(std::istream& source);
+  // Streams `source` through a fixed-size buffer: memory use does not
+  // grow with the input, only with the distinct names and literals
+  explicit Lexer(std::istream& source,
+                 LexerMode mode = LexerMode::TableDriven,
+                 size_t buffer_size = Scanner::kDefaultBufferSize);
+
+  // Same, the streamed file is registered in `sources`
+  Lexer(std::istream& source, SourceTable& sources,
+        LexerMode mode = LexerMode::TableDriven,
+        size_t buffer_size = Scanner::kDefaultBufferSize);
+
+  // Zero-copy: `source` must outlive the Lexer and all its tokens
+  explicit Lexer(std::string_view source,
+                 LexerMode mode = LexerMode::TableDriven);
+
+  // Registers the text in `sources`, whose IdentTable gets the names.
+  // Tokens are decoded through `sources`, which may outlive the Lexer
+  Lexer(std::string_view source, SourceTable& sources,
+        LexerMode mode = LexerMode::TableDriven);
+
+  // Lexes the text of an existing `source` from byte `start` on, so
+  // offsets stay absolute. A speculative lexer yields a DUMMY token for
+  // malformed text instead of aborting: it is used for chunks which may
+  // turn out to start in the middle of a string literal, and for edits
+  Lexer(const SourceFile& source, size_t start, IdentTable& idents,
+        bool speculative = false);
+
+  // Lexer is referenced by its tokens via source_
+  Lexer(const Lexer&) = delete;
+  Lexer& operator=(const Lexer&) = delete;
+
+  IdentTable& GetIdentTable() {
+    return *idents_;
+  }
+
+  // Decodes the tokens, see Token
+  const SourceTable& GetSources() const {
+    return source_->GetSources();
+  }
 
   void Advance();
 
   Token Peek();
 
+  TokenType PeekType() const {
+    return peek_.type;
+  }
+
   Token GetPreviousToken();
 
   // Check current token type and maybe consume it.
@@ -26,12 +76,18 @@ class Lexer {
  private:
   Token GetNextToken();
 
+  Location CurrentLocation() const;
+
   void SkipWhitespace();
 
   void SkipComments();
 
   ////////////////////////////////////////////////////////////////////
 
+  Token MatchTableDriven();
+
+  ////////////////////////////////////////////////////////////////////
+
   std::optional<Token> MatchOperators();
 
   std::optional<TokenType> PeekOperator();
@@ -46,6 +102,11 @@ class Lexer {
 
   std::optional<Token> MatchWords();
 
+  Token MakeWordToken(std::string_view word, Location location);
+
+  // `text` starts with the opening quote and excludes the closing one
+  Token MakeStringToken(std::string_view text, Location location);
+
   ////////////////////////////////////////////////////////////////////
 
   template <typename Func>
@@ -62,8 +123,19 @@ class Lexer {
   // Current token
   Token peek_{};
 
+  // Only built when the caller provides no tables of its own
+  std::optional<IdentTable> own_idents_;
+  IdentTable* idents_;
+  std::optional<SourceTable> own_sources_;
+  // Registers the text so tokens can be decoded by source id. Empty
+  // when lexing a part of someone else's SourceFile
+  std::optional<SourceFile> own_source_;
+  const SourceFile* source_;
+
+  // Streaming scanners report to own_source_, so it goes after
   Scanner scanner_;
-  IdentTable table_;
+  LexerMode mode_;
+  bool speculative_ = false;
 };
 
 }  // namespace lex
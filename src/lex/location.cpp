@@ -0,0 +1,26 @@
+#include <lex/location.hpp>
+#include <lex/source_file.hpp>
+
+#include <fmt/core.h>
+
+namespace lex {
+
+size_t Location::GetLine(const SourceTable& sources) const {
+  const SourceFile* file = sources.Find(source_id);
+  return file == nullptr ? 0 : file->GetLine(abs_pos);
+}
+
+size_t Location::GetColumn(const SourceTable& sources) const {
+  const SourceFile* file = sources.Find(source_id);
+  return file == nullptr ? 0 : file->GetColumn(abs_pos);
+}
+
+std::string Location::Format(const SourceTable& sources) const {
+  if (source_id != kNoSource && sources.Find(source_id) == nullptr) {
+    return fmt::format("offset {}", abs_pos);
+  }
+
+  return fmt::format("line {}, column {}", GetLine(sources) + 1, GetColumn(sources) + 1);
+}
+
+}  // namespace lex
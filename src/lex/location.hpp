@@ -1,27 +1,36 @@
 #pragma once
 
-#include <fmt/core.h>
-
 #include <cstddef>
+#include <cstdint>
 #include <string>
 
 namespace lex {
+class SourceTable;
+
 struct Location {
-  size_t lineno = 0;
-  size_t columnno = 0;
-  size_t abs_pos = 0;
+  uint32_t abs_pos = 0;
+  // See lex::SourceFile, 0 means no source
+  uint32_t source_id = 0;
 
   Location() = default;
-  Location(size_t lineno, size_t columnno, size_t abs_pos)
-      : lineno(lineno), columnno(columnno), abs_pos(abs_pos) {
+  Location(uint32_t abs_pos, uint32_t source_id)
+      : abs_pos(abs_pos), source_id(source_id) {
   }
 
-  std::string Format() const {
-    return fmt::format("line {}, column {}",  lineno + 1, columnno + 1);
-  }
+  // Computed on demand from the line table of the source file, 0 if
+  // the file is not in `sources`
+  size_t GetLine(const SourceTable& sources) const;
+  size_t GetColumn(const SourceTable& sources) const;
+
+  // Falls back to the offset once the file is gone
+  std::string Format(const SourceTable& sources) const;
 
   bool operator<(const Location &other) const {
     return abs_pos < other.abs_pos;
   }
+
+  bool operator==(const Location &other) const {
+    return abs_pos == other.abs_pos && source_id == other.source_id;
+  }
 };
 }  // namespace lex
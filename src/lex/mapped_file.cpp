@@ -0,0 +1,77 @@
+#include <lex/mapped_file.hpp>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <utility>
+
+namespace lex {
+
+////////////////////////////////////////////////////////////////////
+
+std::optional<MappedFile> MappedFile::Open(const char* path) {
+  int fd = ::open(path, O_RDONLY);
+  if (fd < 0) {
+    return std::nullopt;
+  }
+
+  struct stat st {};
+  if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+    ::close(fd);
+    return std::nullopt;
+  }
+
+  size_t size = static_cast<size_t>(st.st_size);
+  if (size == 0) {
+    // mmap refuses zero-length mappings, but an empty view is fine
+    ::close(fd);
+    return MappedFile(nullptr, 0);
+  }
+
+  void* addr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping keeps its own reference to the file
+  ::close(fd);
+
+  if (addr == MAP_FAILED) {
+    return std::nullopt;
+  }
+
+  // Lexer walks the buffer front to back exactly once
+  ::madvise(addr, size, MADV_SEQUENTIAL);
+  return MappedFile(static_cast<const char*>(addr), size);
+}
+
+////////////////////////////////////////////////////////////////////
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr)),
+      size_(std::exchange(other.size_, 0)) {
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+  if (this != &other) {
+    Unmap();
+    data_ = std::exchange(other.data_, nullptr);
+    size_ = std::exchange(other.size_, 0);
+  }
+
+  return *this;
+}
+
+MappedFile::~MappedFile() {
+  Unmap();
+}
+
+////////////////////////////////////////////////////////////////////
+
+void MappedFile::Unmap() {
+  if (data_ != nullptr) {
+    ::munmap(const_cast<char*>(data_), size_);
+    data_ = nullptr;
+    size_ = 0;
+  }
+}
+
+}  // namespace lex
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string_view>
+
+namespace lex {
+
+//////////////////////////////////////////////////////////////////////
+
+/// Read-only memory mapping of a source file, so the Scanner can
+/// slice tokens straight out of the page cache without copying
+class MappedFile {
+ public:
+  /// Returns std::nullopt if the path can't be mapped (pipes, devices,
+  /// missing files) - caller should fall back to the istream Scanner
+  static std::optional<MappedFile> Open(const char* path);
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  MappedFile(MappedFile&& other) noexcept;
+  MappedFile& operator=(MappedFile&& other) noexcept;
+
+  ~MappedFile();
+
+  std::string_view GetView() const {
+    return std::string_view(data_, size_);
+  }
+
+ private:
+  MappedFile(const char* data, size_t size) : data_(data), size_(size) {
+  }
+
+  void Unmap();
+
+ private:
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+//////////////////////////////////////////////////////////////////////
+
+}  // namespace lex
@@ -1,11 +1,13 @@
 #pragma once
 
+#include <lex/source_file.hpp>
 #include <lex/token_type.hpp>
-#include <lex/location.hpp>
+#include <lex/whitespace.hpp>
 
 #include <fmt/core.h>
 
 #include <string_view>
+#include <algorithm>
 #include <filesystem>
 #include <iostream>
 #include <istream>
@@ -19,93 +21,182 @@ namespace lex {
 
 class Scanner {
  public:
-  explicit Scanner(std::istream& source_stream) {
-    // Read whole file into buffer_
-    std::copy(std::istreambuf_iterator<char>(source_stream),
-              std::istreambuf_iterator<char>(), std::back_inserter(buffer_));
-    if (buffer_.length() == 0) {
-      curr_symbol_ = EOF;
-    } else {
-      curr_symbol_ = buffer_[0];
-    }
+  static constexpr size_t kDefaultBufferSize = 64 * 1024;
+
+  // Streaming mode for pipes and inputs too big to hold: the stream is
+  // read through a window of about `buffer_size` bytes, text before the
+  // current token is dropped on every refill. Each chunk is reported to
+  // `sink` as it is read, so line numbers survive the text
+  Scanner(std::istream& source_stream, SourceFile& sink,
+          size_t buffer_size = kDefaultBufferSize)
+      : stream_(&source_stream), sink_(&sink), buffer_size_(buffer_size) {
+    UpdateCurrentSymbol();
   }
 
+  // Zero-copy mode: tokens slice directly into caller-owned source,
+  // which must outlive the Scanner and every token produced from it
+  explicit Scanner(std::string_view source, size_t start = 0)
+      : source_(source), pos_(start) {
+    UpdateCurrentSymbol();
+  }
+
+  // source_ may point into our own buffer_
+  Scanner(const Scanner&) = delete;
+  Scanner& operator=(const Scanner&) = delete;
+
   char CurrentSymbol() const {
     return curr_symbol_;
   }
 
-  char NextSymbol() const {
-    if (curr_loc_.abs_pos + 1 >= buffer_.length()) {
+  char NextSymbol() {
+    if (!Ensure(pos_ + 2)) {
       return EOF;
     }
 
-    return buffer_[curr_loc_.abs_pos + 1];
+    return source_[pos_ + 1 - base_];
   }
 
   void MoveNext() {
-    if (curr_loc_.abs_pos >= buffer_.length()) {
-      curr_symbol_ = EOF;
+    if (curr_symbol_ == EOF) {
       return;
     }
 
-    if (curr_symbol_ == '\n') {
-      curr_loc_.lineno++;
-      curr_loc_.columnno = 0;
-    } else {
-      curr_loc_.columnno++;
-    }
+    pos_++;
+    UpdateCurrentSymbol();
+  }
 
-    curr_loc_.abs_pos++;
-    if (curr_loc_.abs_pos >= buffer_.length()) {
-      curr_symbol_ = EOF;
+  // Trivia is never part of a token, so skipping it moves the token mark
+  // along: a long comment or blank run is not kept in the window
+  void MoveNextLine() {
+    if (curr_symbol_ == EOF) {
       return;
     }
 
-    curr_symbol_ = buffer_[curr_loc_.abs_pos];
-  }
+    do {
+      pos_ += FindNewline(GetRest());
+      mark_ = pos_;
+    } while (pos_ == WindowEnd() && Refill());
 
-  void MoveNextLine() {
-    while (curr_loc_.abs_pos < buffer_.length() &&
-           buffer_[curr_loc_.abs_pos] != '\n') {
-      curr_loc_.abs_pos++;
-    }
+    UpdateCurrentSymbol();
+    // Step over the newline itself, if any
+    MoveNext();
+  }
 
-    if (curr_loc_.abs_pos >= buffer_.length()) {
-      curr_symbol_ = EOF;
+  // Moves over a whole run of whitespace at once
+  void SkipWhitespace() {
+    if (curr_symbol_ == EOF) {
       return;
     }
 
-    curr_loc_.abs_pos++;
-    curr_loc_.lineno++;
-    curr_loc_.columnno = 0;
+    do {
+      pos_ += ScanWhitespace(GetRest());
+      mark_ = pos_;
+    } while (pos_ == WindowEnd() && Refill());
 
-    if (curr_loc_.abs_pos >= buffer_.length()) {
-      curr_symbol_ = EOF;
-    } else {
-      curr_symbol_ = buffer_[curr_loc_.abs_pos];
+    UpdateCurrentSymbol();
+  }
+
+  void MoveForward(size_t count) {
+    pos_ += count;
+    UpdateCurrentSymbol();
+  }
+
+  // Refills never drop the text from here on, so slices of the current
+  // token stay valid until it is finished
+  void MarkTokenStart() {
+    mark_ = pos_;
+  }
+
+  // Unconsumed part of the window, the whole rest of the input unless
+  // streaming. Valid until the next call which moves the position
+  std::string_view GetRest() const {
+    return source_.substr(std::min(pos_ - base_, source_.length()));
+  }
+
+  // Reads the next chunk of the stream into the window. False if there
+  // is nothing more to read, views returned so far are invalidated
+  bool Refill() {
+    if (stream_ == nullptr || !*stream_) {
+      return false;
     }
+
+    // Drop what is already consumed
+    size_t keep = std::min(mark_, pos_);
+    buffer_.erase(0, keep - base_);
+    base_ = keep;
+
+    size_t old_size = buffer_.size();
+    buffer_.resize(old_size + buffer_size_);
+    stream_->read(buffer_.data() + old_size, static_cast<std::streamsize>(buffer_size_));
+    buffer_.resize(old_size + static_cast<size_t>(stream_->gcount()));
+    source_ = buffer_;
+
+    std::string_view chunk = source_.substr(old_size);
+    sink_->AddLines(static_cast<uint32_t>(base_ + old_size), chunk);
+    return !chunk.empty();
   }
 
-  Location GetLocation() const {
-    return curr_loc_;
+  // Bytes held in the window, streaming only
+  size_t GetBufferSize() const {
+    return buffer_.size();
   }
 
-  // [start;end)
-  std::string_view GetSlice(Location start, Location end) const {
-    FMT_ASSERT(start.abs_pos <= buffer_.length() &&
-                   end.abs_pos <= buffer_.length() &&
-                   start.abs_pos < end.abs_pos,
+  // Whole input, empty when streaming
+  std::string_view GetText() const {
+    return stream_ == nullptr ? source_ : std::string_view{};
+  }
+
+  // Line and column are not tracked, see lex::SourceFile
+  size_t GetPosition() const {
+    return pos_;
+  }
+
+  // [start;end), must not reach before the token start when streaming
+  std::string_view GetSlice(size_t start, size_t end) const {
+    FMT_ASSERT(start >= base_ && end <= WindowEnd() && start < end,
                "Could not match any token\n");
 
-    return std::string_view(&buffer_[start.abs_pos],
-                            end.abs_pos - start.abs_pos);
+    return source_.substr(start - base_, end - start);
+  }
+
+ private:
+  size_t WindowEnd() const {
+    return base_ + source_.length();
+  }
+
+  // Makes [pos_; end) available, unless the input ends before that
+  bool Ensure(size_t end) {
+    while (WindowEnd() < end) {
+      if (!Refill()) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  void UpdateCurrentSymbol() {
+    if (!Ensure(pos_ + 1)) {
+      curr_symbol_ = EOF;
+    } else {
+      curr_symbol_ = source_[pos_ - base_];
+    }
   }
 
  private:
   char curr_symbol_ = EOF;
 
+  std::string_view source_;
+  // Absolute positions: source_[0] is byte base_ of the input
+  size_t pos_ = 0;
+  size_t base_ = 0;
+  size_t mark_ = 0;
+
+  // Streaming only
+  std::istream* stream_ = nullptr;
+  SourceFile* sink_ = nullptr;
+  size_t buffer_size_ = 0;
   std::string buffer_;
-  Location curr_loc_;
 };
 
 //////////////////////////////////////////////////////////////////////
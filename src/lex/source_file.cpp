@@ -0,0 +1,116 @@
+#include <lex/source_file.hpp>
+#include <lex/whitespace.hpp>
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace lex {
+
+SourceId SourceTable::Add(const SourceFile* file) {
+  uint32_t index = 0;
+  if (free_.empty()) {
+    if (slots_.size() == (size_t{1} << kSlotBits)) {
+      throw std::length_error("Too many live source files");
+    }
+    index = static_cast<uint32_t>(slots_.size());
+    slots_.emplace_back();
+  } else {
+    index = free_.back();
+    free_.pop_back();
+  }
+
+  Slot& slot = slots_[index];
+  slot.file = file;
+  return (SourceId{slot.generation} << kSlotBits) | index;
+}
+
+void SourceTable::Remove(SourceId id) {
+  uint32_t index = id & ((1u << kSlotBits) - 1);
+  Slot& slot = slots_[index];
+  slot.file = nullptr;
+  // Wraps around: an id stale for 2^16 reuses of its slot is not caught
+  slot.generation++;
+  free_.push_back(index);
+}
+
+////////////////////////////////////////////////////////////////////
+
+SourceFile::SourceFile(std::string_view text, SourceTable& sources)
+    : text_(text), sources_(sources) {
+  FMT_ASSERT(text.size() <= std::numeric_limits<uint32_t>::max(),
+             "Source files are limited to 4 GiB");
+  id_ = sources_.Add(this);
+}
+
+SourceFile::SourceFile(SourceTable& sources)
+    : sources_(sources), streamed_(true) {
+  line_starts_.push_back(0);
+  id_ = sources_.Add(this);
+}
+
+SourceFile::~SourceFile() {
+  sources_.Remove(id_);
+}
+
+////////////////////////////////////////////////////////////////////
+
+void SourceFile::BuildLineTable() const {
+  line_starts_.push_back(0);
+
+  size_t pos = 0;
+  while (true) {
+    pos += FindNewline(text_.substr(pos));
+    if (pos >= text_.size()) {
+      break;
+    }
+
+    line_starts_.push_back(static_cast<uint32_t>(++pos));
+  }
+}
+
+size_t SourceFile::GetLine(uint32_t offset) const {
+  if (!streamed_) {
+    std::call_once(line_table_built_, [this]() {
+      BuildLineTable();
+    });
+  }
+
+  auto next_line = std::upper_bound(line_starts_.begin(), line_starts_.end(), offset);
+  return static_cast<size_t>(next_line - line_starts_.begin()) - 1;
+}
+
+size_t SourceFile::GetColumn(uint32_t offset) const {
+  return offset - line_starts_[GetLine(offset)];
+}
+
+////////////////////////////////////////////////////////////////////
+
+std::string_view SourceFile::GetString(uint32_t offset, uint32_t payload) const {
+  if (!streamed_) {
+    return text_.substr(offset, payload);
+  }
+
+  FMT_ASSERT(payload < literals_.Size(), "No such string literal");
+  return literals_.GetName(payload);
+}
+
+void SourceFile::AddLines(uint32_t offset, std::string_view chunk) {
+  size_t pos = 0;
+  while (true) {
+    pos += FindNewline(chunk.substr(pos));
+    if (pos >= chunk.size()) {
+      break;
+    }
+
+    line_starts_.push_back(offset + static_cast<uint32_t>(++pos));
+  }
+}
+
+SymbolId SourceFile::AddLiteral(std::string_view text) {
+  return literals_.Intern(text);
+}
+
+}  // namespace lex
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <lex/ident_table.hpp>
+
+#include <cstdint>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+namespace lex {
+
+//////////////////////////////////////////////////////////////////////
+
+using SourceId = uint32_t;
+
+// Id of locations which don't belong to any file
+inline constexpr SourceId kNoSource = 0;
+
+class SourceFile;
+
+/// Source ids of one compilation: owned by the caller and passed to
+/// whatever decodes tokens, like types::TypeContext. Slots of destroyed
+/// files are reused, a generation in the upper bits of the id tells a
+/// stale id from the one of the file now in its slot.
+/// Files are added and removed by one thread, while nobody decodes
+class SourceTable {
+ public:
+  explicit SourceTable(IdentTable& idents) : idents_{idents} {
+  }
+
+  SourceTable(const SourceTable&) = delete;
+  SourceTable& operator=(const SourceTable&) = delete;
+
+  // Null for kNoSource and for files which are gone
+  const SourceFile* Find(SourceId id) const {
+    const Slot* slot = FindSlot(id);
+    return slot == nullptr ? nullptr : slot->file;
+  }
+
+  // Shared by all files of the table, names outlive the files
+  const IdentTable& GetIdents() const {
+    return idents_;
+  }
+
+  IdentTable& GetIdents() {
+    return idents_;
+  }
+
+ private:
+  friend class SourceFile;
+
+  SourceId Add(const SourceFile* file);
+  void Remove(SourceId id);
+
+  struct Slot {
+    const SourceFile* file = nullptr;
+    uint16_t generation = 0;
+  };
+
+  static constexpr uint32_t kSlotBits = 16;
+
+  const Slot* FindSlot(SourceId id) const {
+    uint32_t index = id & ((1u << kSlotBits) - 1);
+    if (index >= slots_.size()) {
+      return nullptr;
+    }
+
+    const Slot& slot = slots_[index];
+    return slot.generation == (id >> kSlotBits) ? &slot : nullptr;
+  }
+
+ private:
+  IdentTable& idents_;
+  // Slot 0 is never handed out, so no id equals kNoSource
+  std::vector<Slot> slots_ = std::vector<Slot>(1);
+  std::vector<uint32_t> free_;
+};
+
+//////////////////////////////////////////////////////////////////////
+
+/// Everything a compact Token needs to be decoded: source text for
+/// string literals and line numbers, interned names for identifiers.
+/// Holds an id in `sources` while alive, tokens refer to it by that id
+class SourceFile {
+ public:
+  SourceFile(std::string_view text, SourceTable& sources);
+
+  // Streamed file: the text is never held in full. Line starts and string
+  // literals are recorded while it is being scanned instead
+  explicit SourceFile(SourceTable& sources);
+
+  ~SourceFile();
+
+  SourceFile(const SourceFile&) = delete;
+  SourceFile& operator=(const SourceFile&) = delete;
+
+  SourceId GetId() const {
+    return id_;
+  }
+
+  // Empty for streamed files
+  std::string_view GetText() const {
+    return text_;
+  }
+
+  bool IsStreamed() const {
+    return streamed_;
+  }
+
+  const SourceTable& GetSources() const {
+    return sources_;
+  }
+
+  const IdentTable& GetIdents() const {
+    return sources_.GetIdents();
+  }
+
+  IdentTable& GetIdents() {
+    return sources_.GetIdents();
+  }
+
+  // 0-based line and column of a byte offset. The line table is built
+  // on the first call, so files without diagnostics never pay for it
+  size_t GetLine(uint32_t offset) const;
+  size_t GetColumn(uint32_t offset) const;
+
+  // Text of the string literal token at `offset`, `payload` is its
+  // length, or its id from AddLiteral in a streamed file
+  std::string_view GetString(uint32_t offset, uint32_t payload) const;
+
+  ////////////////////////////////////////////////////////////////////
+
+  // Streamed files only
+
+  // Records line starts of the next chunk of text, starting at `offset`
+  void AddLines(uint32_t offset, std::string_view chunk);
+
+  // Copies the text of a string literal out of the scanner window. The
+  // id goes into the token, so equal literals share one copy
+  SymbolId AddLiteral(std::string_view text);
+
+ private:
+  void BuildLineTable() const;
+
+ private:
+  std::string_view text_;
+  SourceTable& sources_;
+  SourceId id_ = kNoSource;
+  bool streamed_ = false;
+
+  mutable std::once_flag line_table_built_;
+  // Offset of the first byte of every line
+  mutable std::vector<uint32_t> line_starts_;
+
+  // Interned, so repeated literals are stored once
+  IdentTable literals_;
+};
+
+//////////////////////////////////////////////////////////////////////
+
+}  // namespace lex
@@ -1,43 +1,77 @@
 #pragma once
 
+#include <lex/location.hpp>
 #include <lex/scanner.hpp>
+#include <lex/source_file.hpp>
 
-#include <variant>
 #include <cstddef>
+#include <cstdint>
 
 namespace lex {
 
 //////////////////////////////////////////////////////////////////////
 
+// Packed into 16 bytes, everything else is decoded on demand through the
+// SourceTable of the compilation: names from its IdentTable, the rest
+// from the SourceFile
 struct Token {
-  using DataType = std::variant<std::monostate, int, std::string_view>;
-
   TokenType type = TokenType::DUMMY;
-  Location location;
-  DataType data;
+  SourceId source_id = kNoSource;
+  uint32_t offset = 0;
+  // NUMBER: value, IDENTIFIER: symbol id, STRING: length of the text, or
+  // the literal id if the file is streamed
+  uint32_t payload = 0;
 
   Token() = default;
-  Token(TokenType type, Location location,
-        DataType data = std::monostate())
-      : type{type}, location{location}, data{data} {
+  Token(TokenType type, Location location, uint32_t payload = 0)
+      : type{type},
+        source_id{location.source_id},
+        offset{location.abs_pos},
+        payload{payload} {
+  }
+
+  Location GetLocation() const {
+    return Location(offset, source_id);
   }
 
-  std::string_view GetIdentifier() const {
+  std::string_view GetIdentifier(const SourceTable& sources) const {
     FMT_ASSERT(type == TokenType::IDENTIFIER,
                "Requesting the name of non-identifier");
-    return std::get<std::string_view>(data);
+    return sources.GetIdents().GetName(payload);
   }
 
-  explicit operator std::string() {
-    if (auto* str = get_if<std::string_view>(&data)) {
-      return std::string(*str);
-    }
+  SymbolId GetSymbolId() const {
+    FMT_ASSERT(type == TokenType::IDENTIFIER,
+               "Requesting the id of non-identifier");
+    return payload;
+  }
 
-    if (auto* num = get_if<int>(&data)) {
-      return std::to_string(*num);
-    }
+  int GetNumber() const {
+    FMT_ASSERT(type == TokenType::NUMBER, "Requesting the value of non-number");
+    return static_cast<int>(payload);
+  }
+
+  // Empty if the source file is gone
+  std::string_view GetString(const SourceTable& sources) const {
+    FMT_ASSERT(type == TokenType::STRING, "Requesting the text of non-string");
+    const SourceFile* file = sources.Find(source_id);
+    return file == nullptr ? std::string_view{} : file->GetString(offset, payload);
+  }
 
-    FMT_ASSERT(false, "Attempt to request a string from token with no data");
+  std::string Format(const SourceTable& sources) const {
+    switch (type) {
+      case TokenType::NUMBER:
+        return std::to_string(GetNumber());
+      case TokenType::STRING:
+        return std::string(GetString(sources));
+      case TokenType::IDENTIFIER:
+        return std::string(GetIdentifier(sources));
+      default:
+        if (detail::IsKeyword(type)) {
+          return FormatTokenType(type);
+        }
+        FMT_ASSERT(false, "Attempt to request a string from token with no data");
+    }
   }
 
   //    std::string Format() const {
@@ -46,6 +80,8 @@ struct Token {
   //    }
 };
 
+static_assert(sizeof(Token) <= 16, "Token should stay compact");
+
 //////////////////////////////////////////////////////////////////////
 
 }  // namespace lex
@@ -0,0 +1,247 @@
+#include <lex/token_stream.hpp>
+
+#include <algorithm>
+#include <type_traits>
+
+namespace lex {
+
+////////////////////////////////////////////////////////////////////
+
+TokenStream::TokenStream(Lexer& lexer) : sources_(&lexer.GetSources()) {
+  while (true) {
+    Token token = lexer.Peek();
+
+    source_id_ = token.source_id;
+    kinds_.push_back(token.type);
+    offsets_.push_back(token.offset);
+    payloads_.push_back(token.payload);
+
+    if (token.type == TokenType::TOKEN_EOF) {
+      break;
+    }
+
+    lexer.Advance();
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+
+// Smaller files are not worth splitting
+static constexpr size_t kMinChunkSize = 64 * 1024;
+
+struct TokenStream::Chunk {
+  // [begin; end), both at line starts
+  size_t begin = 0;
+  size_t end = 0;
+
+  // Tokens starting inside the chunk
+  std::vector<Token> tokens;
+  // Where the chunk assumed the serial lex would resume
+  uint32_t first = 0;
+  // First token past the end, where the next chunk must resume
+  Token stop;
+  // Speculative lex ran into malformed input
+  bool failed = false;
+
+  // Identifiers are interned locally and remapped on join, so chunks
+  // never contend on the shared table
+  IdentTable idents;
+};
+
+////////////////////////////////////////////////////////////////////
+
+TokenStream::TokenStream(SourceFile& source, utils::ThreadPool& pool)
+    : sources_(&source.GetSources()), source_id_(source.GetId()) {
+  std::string_view text = source.GetText();
+
+  // A few chunks per thread to even out the load
+  size_t chunk_count = std::clamp<size_t>(text.size() / kMinChunkSize, 1,
+                                          pool.Size() * 4);
+
+  std::vector<Chunk> chunks(chunk_count);
+  size_t begin = 0;
+  for (size_t i = 0; i < chunk_count; i++) {
+    size_t end = text.size();
+    if (i + 1 < chunk_count) {
+      // Right after the first newline past the even split point
+      end = std::max(begin, text.size() / chunk_count * (i + 1));
+      end = std::min(end + FindNewline(text.substr(end)) + 1, text.size());
+    }
+
+    chunks[i].begin = begin;
+    chunks[i].end = end;
+    begin = end;
+  }
+
+  pool.ParallelFor(chunk_count, [&](size_t i) {
+    LexChunk(source, chunks[i], chunks[i].begin, chunks[i].idents,
+             /*speculative=*/true);
+  });
+
+  // Join in order. A line start is not necessarily a token boundary:
+  // the previous chunk may end inside a multi-line string literal, with
+  // something like a '#' right after the split. Such a chunk is lexed
+  // again, serially, from the point the previous one actually stopped
+  std::vector<SymbolId> remap;
+  uint32_t resume = chunks[0].first;
+
+  for (auto& chunk : chunks) {
+    if (chunk.failed || chunk.first != resume) {
+      chunk.tokens.clear();
+      LexChunk(source, chunk, resume, source.GetIdents(),
+               /*speculative=*/false);
+      Append(chunk, /*remap=*/{});
+    } else {
+      remap.clear();
+      for (SymbolId id = 0; id < chunk.idents.Size(); id++) {
+        remap.push_back(source.GetIdents().Intern(chunk.idents.GetName(id)));
+      }
+      Append(chunk, remap);
+    }
+
+    resume = chunk.stop.offset;
+  }
+
+  // The stop token of the last chunk is TOKEN_EOF
+  Chunk eof;
+  eof.tokens.push_back(chunks.back().stop);
+  Append(eof, /*remap=*/{});
+}
+
+////////////////////////////////////////////////////////////////////
+
+void TokenStream::LexChunk(const SourceFile& source, Chunk& chunk,
+                           size_t start, IdentTable& idents,
+                           bool speculative) {
+  Lexer lexer{source, start, idents, speculative};
+  chunk.first = lexer.Peek().offset;
+
+  while (true) {
+    Token token = lexer.Peek();
+
+    if (token.offset >= chunk.end || token.type == TokenType::TOKEN_EOF) {
+      chunk.stop = token;
+      return;
+    }
+
+    if (token.type == TokenType::DUMMY) {
+      chunk.failed = true;
+      return;
+    }
+
+    chunk.tokens.push_back(token);
+    lexer.Advance();
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+
+void TokenStream::Append(const Chunk& chunk,
+                         const std::vector<SymbolId>& remap) {
+  for (const Token& token : chunk.tokens) {
+    kinds_.push_back(token.type);
+    offsets_.push_back(token.offset);
+
+    if (token.type == TokenType::IDENTIFIER && !remap.empty()) {
+      payloads_.push_back(remap[token.payload]);
+    } else {
+      payloads_.push_back(token.payload);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+
+size_t TokenStream::ApplyEdit(SourceFile& source, const TextEdit& edit) {
+  FMT_ASSERT(source.GetText().substr(edit.offset, edit.inserted.size()) ==
+                 edit.inserted,
+             "Source does not contain the edit");
+  FMT_ASSERT(&source.GetSources() == sources_,
+             "Edited source belongs to another table");
+
+  auto edit_start = static_cast<uint32_t>(edit.offset);
+  auto edit_end = static_cast<uint32_t>(edit.offset + edit.removed);
+  int64_t delta = static_cast<int64_t>(edit.inserted.size()) -
+                  static_cast<int64_t>(edit.removed);
+
+  // Tokens are lexed looking at most one byte past their end, so the
+  // ones before the last token starting ahead of the edit are intact.
+  // Lexer has no state besides the position, so lexing from that token
+  // gives exactly what a full lex would
+  size_t first = std::lower_bound(offsets_.begin(), offsets_.end(), edit_start) -
+                 offsets_.begin();
+  size_t restart = 0;
+  if (first != 0) {
+    restart = offsets_[--first];
+  }
+
+  // Old tokens starting past the removed text survive the edit intact
+  size_t old_next = std::lower_bound(offsets_.begin(), offsets_.end(), edit_end) -
+                    offsets_.begin();
+
+  // The edited text may be malformed, e.g. a quote just typed opens a
+  // string up to the end. It becomes DUMMY tokens, the same ones a
+  // speculative full lex yields
+  std::vector<Token> relexed;
+  Lexer lexer{source, restart, source.GetIdents(), /*speculative=*/true};
+
+  while (true) {
+    Token token = lexer.Peek();
+
+    // Synchronized once the new lex reaches the shifted start of some
+    // old token, from then on both lex the same text
+    while (old_next < offsets_.size() && offsets_[old_next] + delta < token.offset) {
+      old_next++;
+    }
+    if (old_next < offsets_.size() && offsets_[old_next] + delta == token.offset) {
+      break;
+    }
+
+    relexed.push_back(token);
+    lexer.Advance();
+  }
+
+  // Old tokens in [first; old_next) are replaced by the new ones
+  size_t replaced = old_next - first;
+  size_t common = std::min(replaced, relexed.size());
+
+  auto splice = [&](auto& column, auto get) {
+    for (size_t i = 0; i < common; i++) {
+      column[first + i] = get(relexed[i]);
+    }
+
+    if (relexed.size() < replaced) {
+      column.erase(column.begin() + first + common,
+                   column.begin() + old_next);
+    } else {
+      std::vector<std::decay_t<decltype(column[0])>> rest;
+      for (size_t i = common; i < relexed.size(); i++) {
+        rest.push_back(get(relexed[i]));
+      }
+      column.insert(column.begin() + first + common, rest.begin(), rest.end());
+    }
+  };
+
+  splice(kinds_, [](const Token& token) {
+    return token.type;
+  });
+  splice(offsets_, [](const Token& token) {
+    return token.offset;
+  });
+  splice(payloads_, [](const Token& token) {
+    return token.payload;
+  });
+
+  if (delta != 0) {
+    for (size_t i = first + relexed.size(); i < offsets_.size(); i++) {
+      offsets_[i] = static_cast<uint32_t>(offsets_[i] + delta);
+    }
+  }
+
+  source_id_ = source.GetId();
+  cursor_ = Clamp(cursor_);
+
+  return relexed.size();
+}
+
+}  // namespace lex
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <lex/lexer.hpp>
+
+#include <utils/thread_pool.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace lex {
+
+//////////////////////////////////////////////////////////////////////
+
+// Replaces `removed` bytes at `offset` with `inserted`
+struct TextEdit {
+  size_t offset = 0;
+  size_t removed = 0;
+  std::string_view inserted;
+};
+
+//////////////////////////////////////////////////////////////////////
+
+/// Whole file lexed up front into parallel arrays. Walked by index,
+/// so lookahead of any depth costs nothing and kinds are compared
+/// without materializing a Token
+class TokenStream {
+ public:
+  // Drains `lexer` up to and including TOKEN_EOF. The tokens are decoded
+  // through the SourceTable of `lexer`, which must outlive the stream
+  explicit TokenStream(Lexer& lexer);
+
+  // Splits `source` into chunks at line starts and lexes them on `pool`.
+  // Produces exactly the tokens, offsets and symbol ids of a serial lex
+  TokenStream(SourceFile& source, utils::ThreadPool& pool);
+
+  size_t Size() const {
+    return kinds_.size();
+  }
+
+  const SourceTable& GetSources() const {
+    return *sources_;
+  }
+
+  TokenType GetType(size_t index) const {
+    return kinds_[Clamp(index)];
+  }
+
+  Location GetLocation(size_t index) const {
+    return Location(offsets_[Clamp(index)], source_id_);
+  }
+
+  Token GetToken(size_t index) const {
+    index = Clamp(index);
+    return Token(kinds_[index], GetLocation(index), payloads_[index]);
+  }
+
+  ////////////////////////////////////////////////////////////////////
+
+  // Cursor, mirrors the streaming interface of Lexer
+
+  void Advance() {
+    if (cursor_ + 1 < kinds_.size()) {
+      cursor_++;
+    }
+  }
+
+  Token Peek() const {
+    return GetToken(cursor_);
+  }
+
+  TokenType PeekType(size_t ahead = 0) const {
+    return GetType(cursor_ + ahead);
+  }
+
+  Token GetPreviousToken() const {
+    return cursor_ == 0 ? Token{} : GetToken(cursor_ - 1);
+  }
+
+  bool Matches(TokenType type) {
+    if (PeekType() == type) {
+      Advance();
+      return true;
+    }
+
+    return false;
+  }
+
+  size_t GetPosition() const {
+    return cursor_;
+  }
+
+  void SetPosition(size_t position) {
+    cursor_ = Clamp(position);
+  }
+
+  ////////////////////////////////////////////////////////////////////
+
+  // Brings the stream up to date with `source`, the text after `edit`.
+  // Lexes again from the last token starting before the edit until the
+  // new tokens line up with the old ones, everything later is shifted.
+  // Malformed text becomes DUMMY tokens rather than an abort.
+  // `source` must be in the SourceTable of the old text. Returns the
+  // number of tokens lexed again
+  size_t ApplyEdit(SourceFile& source, const TextEdit& edit);
+
+ private:
+  // Everything past the end reads as the trailing TOKEN_EOF
+  size_t Clamp(size_t index) const {
+    return index < kinds_.size() ? index : kinds_.size() - 1;
+  }
+
+ private:
+  struct Chunk;
+
+  static void LexChunk(const SourceFile& source, Chunk& chunk, size_t start,
+                       IdentTable& idents, bool speculative);
+
+  // `remap` translates chunk-local symbol ids, empty if they are global
+  void Append(const Chunk& chunk, const std::vector<SymbolId>& remap);
+
+ private:
+  std::vector<TokenType> kinds_;
+  std::vector<uint32_t> offsets_;
+  // Token::payload, meaning depends on the kind
+  std::vector<uint32_t> payloads_;
+
+  // All tokens come from the same lexer, hence the same source
+  const SourceTable* sources_ = nullptr;
+  SourceId source_id_ = kNoSource;
+
+  size_t cursor_ = 0;
+};
+
+//////////////////////////////////////////////////////////////////////
+
+}  // namespace lex
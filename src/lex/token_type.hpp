@@ -1,12 +1,13 @@
 #pragma once
 
 #include <fmt/core.h>
+#include <cstdint>
 #include <cstdlib>
 
 namespace lex {
 //////////////////////////////////////////////////////////////////////
 
-enum class TokenType {
+enum class TokenType : uint8_t {
   DUMMY,
   NUMBER,
   STRING,
@@ -53,7 +54,7 @@ enum class TokenType {
 
 ////////////////////////////////////////////////////////////////
 
-inline const char* FormatTokenType(TokenType type) {
+constexpr const char* FormatTokenType(TokenType type) {
   switch (type) {
     case TokenType::DUMMY:
       return "<DUMMY>";
@@ -95,12 +96,18 @@ inline const char* FormatTokenType(TokenType type) {
       return "(";
     case TokenType::RIGHT_BRACE:
       return ")";
+    case TokenType::LEFT_SBRACE:
+      return "[";
+    case TokenType::RIGHT_SBRACE:
+      return "]";
     case TokenType::COMMA:
       return ",";
     case TokenType::COLUMN:
       return ":";
     case TokenType::SEMICOLON:
       return ";";
+    case TokenType::ARROW:
+      return "->";
     case TokenType::FUN:
       return "fun";
     case TokenType::VAR:
@@ -117,6 +124,8 @@ inline const char* FormatTokenType(TokenType type) {
       return "return";
     case TokenType::YIELD:
       return "yield";
+    case TokenType::OF:
+      return "of";
     case TokenType::TY_INT:
       return "Int";
     case TokenType::TY_BOOL:
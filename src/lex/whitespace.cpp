@@ -0,0 +1,111 @@
+#include <lex/whitespace.hpp>
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace lex {
+
+////////////////////////////////////////////////////////////////////
+
+size_t ScanWhitespaceScalar(std::string_view text) {
+  size_t length = 0;
+  while (length < text.size() && IsWhitespace(text[length])) {
+    length++;
+  }
+
+  return length;
+}
+
+////////////////////////////////////////////////////////////////////
+
+#if defined(__x86_64__)
+
+size_t ScanWhitespaceSse2(std::string_view text) {
+  const __m128i space = _mm_set1_epi8(' ');
+  const __m128i tab = _mm_set1_epi8('\t');
+  const __m128i newline = _mm_set1_epi8('\n');
+
+  size_t offset = 0;
+  for (; offset + 16 <= text.size(); offset += 16) {
+    __m128i block = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(text.data() + offset));
+
+    __m128i is_ws = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(block, space), _mm_cmpeq_epi8(block, tab)),
+        _mm_cmpeq_epi8(block, newline));
+
+    auto ws_mask = static_cast<uint32_t>(_mm_movemask_epi8(is_ws));
+    if (ws_mask != 0xFFFF) {
+      return offset + __builtin_ctz(~ws_mask);
+    }
+  }
+
+  // Last partial block
+  return offset + ScanWhitespaceScalar(text.substr(offset));
+}
+
+////////////////////////////////////////////////////////////////////
+
+__attribute__((target("avx2")))
+size_t ScanWhitespaceAvx2(std::string_view text) {
+  const __m256i space = _mm256_set1_epi8(' ');
+  const __m256i tab = _mm256_set1_epi8('\t');
+  const __m256i newline = _mm256_set1_epi8('\n');
+
+  size_t offset = 0;
+  for (; offset + 32 <= text.size(); offset += 32) {
+    __m256i block = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(text.data() + offset));
+
+    __m256i is_ws = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(block, space),
+                                                    _mm256_cmpeq_epi8(block, tab)),
+                                    _mm256_cmpeq_epi8(block, newline));
+
+    auto ws_mask = static_cast<uint32_t>(_mm256_movemask_epi8(is_ws));
+    if (ws_mask != 0xFFFFFFFF) {
+      return offset + __builtin_ctz(~ws_mask);
+    }
+  }
+
+  // Last partial block
+  return offset + ScanWhitespaceScalar(text.substr(offset));
+}
+
+////////////////////////////////////////////////////////////////////
+
+bool CpuHasAvx2() {
+  static const bool has_avx2 = __builtin_cpu_supports("avx2");
+  return has_avx2;
+}
+
+#endif
+
+////////////////////////////////////////////////////////////////////
+
+size_t ScanWhitespace(std::string_view text) {
+#if defined(__x86_64__)
+  // SSE2 is part of the x86-64 baseline
+  static const auto impl = CpuHasAvx2() ? &ScanWhitespaceAvx2 : &ScanWhitespaceSse2;
+  return impl(text);
+#else
+  return ScanWhitespaceScalar(text);
+#endif
+}
+
+////////////////////////////////////////////////////////////////////
+
+size_t FindNewline(std::string_view text) {
+  if (text.empty()) {
+    return 0;
+  }
+
+  // libc memchr is already vectorized and dispatched per CPU
+  auto pos = static_cast<const char*>(std::memchr(text.data(), '\n', text.size()));
+  return pos == nullptr ? text.size() : static_cast<size_t>(pos - text.data());
+}
+
+}  // namespace lex
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+namespace lex {
+
+//////////////////////////////////////////////////////////////////////
+
+inline bool IsWhitespace(char ch) {
+  return ch == ' ' || ch == '\n' || ch == '\t';
+}
+
+//////////////////////////////////////////////////////////////////////
+
+/// Length of the whitespace prefix of `text`, picking the widest SIMD
+/// implementation supported by the CPU at runtime
+size_t ScanWhitespace(std::string_view text);
+
+/// Offset of the first '\n' in `text` or text.size() if there is none
+size_t FindNewline(std::string_view text);
+
+//////////////////////////////////////////////////////////////////////
+
+// Reference implementation, one byte at a time
+size_t ScanWhitespaceScalar(std::string_view text);
+
+#if defined(__x86_64__)
+size_t ScanWhitespaceSse2(std::string_view text);
+size_t ScanWhitespaceAvx2(std::string_view text);
+
+bool CpuHasAvx2();
+#endif
+
+//////////////////////////////////////////////////////////////////////
+
+}  // namespace lex
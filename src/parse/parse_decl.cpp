@@ -6,11 +6,16 @@
 ast::Program* parse::Parser::ParseProgram() {
   bool errors_occured = false;
   std::vector<ast::Declaration*> decls;
-  while (!lexer_.Matches(lex::TokenType::TOKEN_EOF)) {
+  while (!Matches(lex::TokenType::TOKEN_EOF)) {
     try {
       ast::Declaration* decl = ParseDeclaration();
       if (decl == nullptr) {
-        throw parse::errors::ParseDeclarationError((lexer_.Peek().location.Format()));
+        Fail(parse::errors::ParseDeclarationError(FormatLocation()));
+        decl = FailedStatement();
+      }
+
+      if (Failed()) {
+        Recover();
       }
 
       decls.push_back(decl);
@@ -25,13 +30,126 @@ ast::Program* parse::Parser::ParseProgram() {
     throw parse::errors::ParseProgramError();
   }
 
-  return new ast::Program(std::move(decls));
+  return arena_.New<ast::Program>(arena_.NewArray(decls));
+}
+
+///////////////////////////////////////////////////////////////////
+
+namespace {
+
+// Tokens per parallel task. Fixed, so the split (and so recovery from
+// broken input) does not depend on the number of threads
+constexpr size_t kBatchTokens = 16 * 1024;
+
+struct Batch {
+  ast::Arena arena;
+  ast::Program* program = nullptr;
+  std::vector<parse::errors::ParseError> errors;
+};
+
+}  // namespace
+
+ast::Program* parse::Parser::ParseProgram(utils::ThreadPool& pool) {
+  FMT_ASSERT(stream_ != nullptr, "Parallel parsing needs a token stream\n");
+
+  // Declarations end at a ';' outside of braces, cut the batches there
+  std::vector<std::pair<size_t, size_t>> ranges;
+  size_t depth = 0;
+  size_t begin = pos_;
+  for (size_t i = pos_; i < end_; i++) {
+    switch (stream_->GetType(i)) {
+      case lex::TokenType::LEFT_CBRACE:
+        depth++;
+        break;
+
+      case lex::TokenType::RIGHT_CBRACE:
+        depth = depth > 0 ? depth - 1 : 0;
+        break;
+
+      case lex::TokenType::SEMICOLON:
+        if (depth == 0 && i + 1 - begin >= kBatchTokens) {
+          ranges.emplace_back(begin, i + 1);
+          begin = i + 1;
+        }
+        break;
+
+      default:
+        break;
+    }
+  }
+
+  if (ranges.empty()) {
+    return ParseProgram();
+  }
+
+  if (begin < end_) {
+    ranges.emplace_back(begin, end_);
+  }
+
+  auto parse_batch = [&](Batch& batch, size_t begin, size_t end) {
+    Parser parser(*stream_, begin, end, type_keeper_, batch.arena, ErrorMode::Recover);
+    parser.lazy_ = lazy_;
+    parser.iterative_ = iterative_;
+    batch.program = parser.ParseProgram();
+    batch.errors = parser.GetErrors();
+  };
+
+  std::vector<Batch> batches(ranges.size());
+  pool.ParallelFor(batches.size(), [&](size_t i) {
+    parse_batch(batches[i], ranges[i].first, ranges[i].second);
+  });
+
+  // Recovery may leave a block open and skip past the ';' the split was
+  // made at, the batches after a broken one may then start mid-body.
+  // Parse from the first broken batch to the end in one go instead
+  size_t parsed = std::find_if(batches.begin(), batches.end(), [](const Batch& batch) {
+    return !batch.errors.empty();
+  }) - batches.begin();
+
+  Batch tail;
+  if (parsed < batches.size()) {
+    parse_batch(tail, ranges[parsed].first, end_);
+  }
+
+  std::vector<Batch*> merged;
+  for (size_t i = 0; i < parsed; i++) {
+    merged.push_back(&batches[i]);
+  }
+  if (tail.program != nullptr) {
+    merged.push_back(&tail);
+  }
+
+  std::vector<ast::Declaration*> decls;
+  for (Batch* batch : merged) {
+    arena_.Absorb(batch->arena);
+    decls.insert(decls.end(), batch->program->decls_.begin(), batch->program->decls_.end());
+
+    for (auto& error : batch->errors) {
+      if (mode_ == ErrorMode::Throw) {
+        ReportError(error);
+      } else {
+        errors_.push_back(std::move(error));
+      }
+    }
+  }
+
+  pos_ = end_;
+
+  if (!tail.errors.empty() && mode_ == ErrorMode::Throw) {
+    throw parse::errors::ParseProgramError();
+  }
+
+  return arena_.New<ast::Program>(arena_.NewArray(decls));
 }
 
 ///////////////////////////////////////////////////////////////////
 
 ast::Declaration* parse::Parser::ParseDeclaration() {
   types::Type* type = ParseSignature();
+  if (Failed()) {
+    return FailedStatement();
+  }
+
   if (type == nullptr) {
     return nullptr;
   }
@@ -40,42 +158,132 @@ ast::Declaration* parse::Parser::ParseDeclaration() {
     return var_declaration;
   }
 
+  if (Failed()) {
+    return FailedStatement();
+  }
+
   if (auto fun_declaration = ParseFunDeclStatement(type)) {
     return fun_declaration;
   }
 
-  throw parse::errors::ParseDeclarationError(lexer_.Peek().location.Format());
+  if (!Failed()) {
+    Fail(parse::errors::ParseDeclarationError(FormatLocation()));
+  }
+
+  return FailedStatement();
 }
 
 ///////////////////////////////////////////////////////////////////
 
 ast::FunDeclStatement* parse::Parser::ParseFunDeclStatement(types::Type* type) {
-  lex::Location location = lexer_.Peek().location;
-  if (!Matches(lex::TokenType::FUN)) {
+  FunDeclHead head;
+  if (!ParseFunDeclHead(&head)) {
     return nullptr;
   }
 
-  lex::Token fun_name = lexer_.Peek();
-  Consume(lex::TokenType::IDENTIFIER);
-  Consume(lex::TokenType::LEFT_BRACE);
-  auto args = ParseFunctionArgs();
-  Consume(lex::TokenType::RIGHT_BRACE);
-  Consume(lex::TokenType::ASSIGN);
-  ast::Expression* body = ParseExpression();
-  Consume(lex::TokenType::SEMICOLON);
+  ast::Expression* body = nullptr;
+  if (lazy_ != nullptr) {
+    SkipBody();
+  } else {
+    body = ParseExpression();
+    if (Failed()) {
+      return nullptr;
+    }
+  }
+
+  return FinishFunDecl(type, head, body);
+}
+
+bool parse::Parser::ParseFunDeclHead(FunDeclHead* head) {
+  head->location = PeekLocation();
+  if (!Matches(lex::TokenType::FUN)) {
+    return false;
+  }
+
+  head->name = Peek();
+  if (!Consume(lex::TokenType::IDENTIFIER) || !Consume(lex::TokenType::LEFT_BRACE)) {
+    return false;
+  }
+
+  head->params = ParseFunctionArgs();
+  if (!Consume(lex::TokenType::RIGHT_BRACE) || !Consume(lex::TokenType::ASSIGN)) {
+    return false;
+  }
+
+  head->body_begin = pos_;
+  return true;
+}
+
+ast::FunDeclStatement* parse::Parser::FinishFunDecl(types::Type* type, FunDeclHead& head,
+                                                    ast::Expression* body) {
+  size_t body_end = pos_;
+  if (!Consume(lex::TokenType::SEMICOLON)) {
+    return nullptr;
+  }
 
-  auto func_type = dynamic_cast<types::FunctionType*>(type);
+  auto func_type = utils::dyn_cast<types::FunctionType>(type);
   if (func_type == nullptr) {
-    func_type = type_keeper_.CreateType<types::FunctionType>(type, std::vector<types::Type*>{});
+    func_type = type_keeper_.GetFunctionType(type, {});
   }
 
   // TODO: move this checks to the separate pass?
-  if (func_type->GetArgTypes().size() != args.size()) {
+  if (func_type->GetArgTypes().size() != head.params.size()) {
     // Amount of arguments doesn't match with specified function type
-    throw parse::errors::FnDeclArgsCountMismatchError(location.Format());
+    Fail(parse::errors::FnDeclArgsCountMismatchError(FormatLocation(head.location)));
+    return nullptr;
+  }
+
+  auto* decl = arena_.New<ast::FunDeclStatement>(head.name, arena_.NewArray(head.params),
+                                                 func_type, body);
+  if (lazy_ != nullptr) {
+    decl->SetLazyBody(lazy_, head.body_begin, body_end);
   }
 
-  return new ast::FunDeclStatement(fun_name, std::move(args), func_type, body);
+  return decl;
+}
+
+///////////////////////////////////////////////////////////////////
+
+void parse::Parser::SkipBody() {
+  size_t depth = 0;
+  for (; pos_ < end_; pos_++) {
+    switch (stream_->GetType(pos_)) {
+      case lex::TokenType::LEFT_CBRACE:
+        depth++;
+        break;
+
+      case lex::TokenType::RIGHT_CBRACE:
+        depth = depth > 0 ? depth - 1 : 0;
+        break;
+
+      case lex::TokenType::SEMICOLON:
+        if (depth == 0) {
+          return;
+        }
+        break;
+
+      default:
+        break;
+    }
+  }
+}
+
+ast::Expression* parse::Parser::ParseBody(size_t begin, size_t end) {
+  std::lock_guard guard(body_mutex_);
+
+  Parser parser(*stream_, begin, end, type_keeper_, arena_, mode_);
+  parser.lazy_ = lazy_;
+  parser.iterative_ = iterative_;
+
+  ast::Expression* body = parser.ParseExpression();
+  if (!parser.Failed() && parser.PeekType() != lex::TokenType::TOKEN_EOF) {
+    // Eager parsing would expect the ';' here
+    body = parser.Fail(parse::errors::ParseTokenError(
+        lex::FormatTokenType(lex::TokenType::SEMICOLON), parser.FormatLocation()));
+  }
+
+  errors_.insert(errors_.end(), parser.errors_.begin(), parser.errors_.end());
+  return body;
 }
 
 ///////////////////////////////////////////////////////////////////
@@ -84,7 +292,7 @@ std::vector<lex::Token> parse::Parser::ParseFunctionArgs() {
   std::vector<lex::Token> args;
 
   while (Matches(lex::TokenType::IDENTIFIER)) {
-    args.push_back(lexer_.GetPreviousToken());
+    args.push_back(GetPreviousToken());
     if (!Matches(lex::TokenType::COMMA)) {
       break;
     }
@@ -96,16 +304,35 @@ std::vector<lex::Token> parse::Parser::ParseFunctionArgs() {
 ///////////////////////////////////////////////////////////////////
 
 ast::VarDeclStatement* parse::Parser::ParseVarDeclStatement(types::Type* type) {
-  if (!Matches(lex::TokenType::VAR)) {
+  lex::Token var_name;
+  if (!ParseVarDeclHead(&var_name)) {
     return nullptr;
   }
 
-  lex::Token var_name = lexer_.Peek();
-  Consume(lex::TokenType::IDENTIFIER);
-  Consume(lex::TokenType::ASSIGN);
   ast::Expression* value = ParseExpression();
-  Consume(lex::TokenType::SEMICOLON);
-  return new ast::VarDeclStatement(var_name, type, value);
+  if (Failed()) {
+    return nullptr;
+  }
+
+  return FinishVarDecl(type, var_name, value);
+}
+
+bool parse::Parser::ParseVarDeclHead(lex::Token* name) {
+  if (!Matches(lex::TokenType::VAR)) {
+    return false;
+  }
+
+  *name = Peek();
+  return Consume(lex::TokenType::IDENTIFIER) && Consume(lex::TokenType::ASSIGN);
+}
+
+ast::VarDeclStatement* parse::Parser::FinishVarDecl(types::Type* type, lex::Token name,
+                                                    ast::Expression* value) {
+  if (!Consume(lex::TokenType::SEMICOLON)) {
+    return nullptr;
+  }
+
+  return arena_.New<ast::VarDeclStatement>(name, type, value);
 }
 
 ///////////////////////////////////////////////////////////////////
@@ -5,7 +5,10 @@
 
 namespace parse::errors {
 
-struct ParseError : ::errors::CompileError {};
+struct ParseError : ::errors::CompileError {
+  // Stands for errors already reported one by one inside a block
+  bool compound = false;
+};
 
 struct ParsePrimaryError : ParseError {
   explicit ParsePrimaryError(const std::string& location) {
@@ -41,6 +44,7 @@ struct ParseTokenError : ParseError {
 
 struct ParseCompoundError : ParseError {
   explicit ParseCompoundError(const std::string& location) {
+    compound = true;
     message = fmt::format(
         "Some errors in compound block at location {} have occured", location);
   }
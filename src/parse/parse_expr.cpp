@@ -1,10 +1,17 @@
 #include <parse/parser.hpp>
 #include <parse/parse_error.hpp>
 
+#include <array>
+#include <vector>
+
 ////////////////////////////////////////////////////////////////////
 
 ast::Expression* parse::Parser::ParseExpression() {
-  return ParseEqualityExpression();
+  if (iterative_) {
+    return ParseExpressionIteratively();
+  }
+
+  return ParseInfixExpression(1);
 }
 
 ///////////////////////////////////////////////////////////////////
@@ -32,19 +39,27 @@ ast::Expression* parse::Parser::ParseIfExpression() {
     return nullptr;
   }
 
-  lex::Token if_token = lexer_.GetPreviousToken();
+  lex::Token if_token = GetPreviousToken();
 
   ast::Expression *condition = ParseExpression();
+  if (Failed() || !Consume(lex::TokenType::THEN)) {
+    return error_;
+  }
 
-  Consume(lex::TokenType::THEN);
   ast::Expression *then_expr = ParseExpression();
+  if (Failed()) {
+    return error_;
+  }
 
   ast::Expression *else_expr = nullptr;
   if (Matches(lex::TokenType::ELSE))  {
     else_expr = ParseExpression();
+    if (Failed()) {
+      return error_;
+    }
   }
 
-  return new ast::IfExpression(if_token, condition, then_expr, else_expr);
+  return arena_.New<ast::IfExpression>(if_token, condition, then_expr, else_expr);
 }
 ////////////////////////////////////////////////////////////////////
 
@@ -53,18 +68,29 @@ ast::Expression* parse::Parser::ParseCompoundExpression() {
     return nullptr;
   }
 
-  lex::Token compound_start_token = lexer_.GetPreviousToken();
+  lex::Token compound_start_token = GetPreviousToken();
 
   bool errors_occured = false;
   std::vector<ast::Statement*> statements;
-  while (!lexer_.Matches(lex::TokenType::RIGHT_CBRACE)) {
+  while (!Matches(lex::TokenType::RIGHT_CBRACE)) {
+    if (PeekType() == lex::TokenType::TOKEN_EOF) {
+      // Unterminated block, there is nothing to synchronize on
+      if (!Consume(lex::TokenType::RIGHT_CBRACE)) {
+        return error_;
+      }
+    }
+
     try {
-      ast::Declaration* decl = ParseDeclaration();
-      if (decl != nullptr) {
-        statements.push_back(decl);
-      } else {
-        statements.push_back(ParseStatement());
+      ast::Statement* stmt = ParseDeclaration();
+      if (stmt == nullptr && !Failed()) {
+        stmt = ParseStatement();
       }
+
+      if (Failed()) {
+        Recover();
+      }
+
+      statements.push_back(stmt);
     } catch (parse::errors::ParseError& error) {
       ReportError(error);
       Synchronize();
@@ -73,59 +99,92 @@ ast::Expression* parse::Parser::ParseCompoundExpression() {
   }
 
   if (errors_occured) {
-    throw parse::errors::ParseCompoundError(compound_start_token.location.Format());
+    throw parse::errors::ParseCompoundError(FormatLocation(compound_start_token.GetLocation()));
   }
 
-  return new ast::BlockExpression(std::move(statements));
+  return arena_.New<ast::BlockExpression>(arena_.NewArray(statements));
 }
 
 ////////////////////////////////////////////////////////////////////
 
-ast::Expression* parse::Parser::ParseEqualityExpression() {
-  return ParseBinaryExpression<
-      &Parser::ParseRelationalExpression,
-      ast::ComparisonExpression,
-      lex::TokenType::EQUALS, lex::TokenType::NOT_EQ
-      >();
-}
+namespace {
 
-////////////////////////////////////////////////////////////////////
+enum class InfixNode : uint8_t {
+  Binary,
+  Comparison,
+};
 
-ast::Expression* parse::Parser::ParseRelationalExpression() {
-  return ParseBinaryExpression<
-      &Parser::ParseAdditiveExpression,
-      ast::ComparisonExpression,
-      lex::TokenType::LT, lex::TokenType::GT
-      >();
-}
+struct InfixOperator {
+  // Binding power, 0 for tokens which are not infix operators
+  uint8_t precedence = 0;
+  InfixNode node = InfixNode::Binary;
+};
 
-////////////////////////////////////////////////////////////////////
+// All infix operators are left-associative. A new precedence level is
+// a new row here
+constexpr auto kInfixOperators = []() {
+  std::array<InfixOperator, 256> table{};
 
-ast::Expression* parse::Parser::ParseAdditiveExpression() {
-  return ParseBinaryExpression<
-      &Parser::ParseMultiplicativeExpression,
-      ast::BinaryExpression,
-      lex::TokenType::PLUS, lex::TokenType::MINUS
-      >();
-}
+  table[size_t(lex::TokenType::EQUALS)] = {1, InfixNode::Comparison};
+  table[size_t(lex::TokenType::NOT_EQ)] = {1, InfixNode::Comparison};
+
+  table[size_t(lex::TokenType::LT)] = {2, InfixNode::Comparison};
+  table[size_t(lex::TokenType::GT)] = {2, InfixNode::Comparison};
+
+  table[size_t(lex::TokenType::PLUS)] = {3, InfixNode::Binary};
+  table[size_t(lex::TokenType::MINUS)] = {3, InfixNode::Binary};
+
+  table[size_t(lex::TokenType::STAR)] = {4, InfixNode::Binary};
+  table[size_t(lex::TokenType::DIV)] = {4, InfixNode::Binary};
+
+  return table;
+}();
+
+}  // namespace
 
 ////////////////////////////////////////////////////////////////////
 
-ast::Expression* parse::Parser::ParseMultiplicativeExpression() {
-  return ParseBinaryExpression<
-      &parse::Parser::ParseUnaryExpression,
-      ast::BinaryExpression,
-      lex::TokenType::STAR, lex::TokenType::DIV
-      >();
+ast::Expression* parse::Parser::ParseInfixExpression(uint8_t min_precedence) {
+  ast::Expression* lhs = ParseUnaryExpression();
+  if (Failed()) {
+    return error_;
+  }
+
+  while (true) {
+    InfixOperator op = kInfixOperators[size_t(PeekType())];
+    if (op.precedence < min_precedence) {
+      return lhs;
+    }
+
+    lex::Token operation = Peek();
+    Advance();
+
+    // Operators of the same level are left to the next iteration, which
+    // makes them associate to the left
+    ast::Expression* rhs = ParseInfixExpression(op.precedence + 1);
+    if (Failed()) {
+      return error_;
+    }
+
+    if (op.node == InfixNode::Comparison) {
+      lhs = arena_.New<ast::ComparisonExpression>(operation, lhs, rhs);
+    } else {
+      lhs = arena_.New<ast::BinaryExpression>(operation, lhs, rhs);
+    }
+  }
 }
 
 ////////////////////////////////////////////////////////////////////
 
 ast::Expression* parse::Parser::ParseUnaryExpression() {
-  lex::Token token = lexer_.Peek();
+  lex::Token token = Peek();
   if (Matches(lex::TokenType::MINUS) || Matches(lex::TokenType::NOT)) {
     ast::Expression* expr = ParseUnaryExpression();
-    return new ast::UnaryExpression(token, expr);
+    if (Failed()) {
+      return error_;
+    }
+
+    return arena_.New<ast::UnaryExpression>(token, expr);
   }
 
   return ParsePostfixExpression();
@@ -135,23 +194,32 @@ ast::Expression* parse::Parser::ParseUnaryExpression() {
 
 ast::Expression* parse::Parser::ParsePostfixExpression() {
   ast::Expression* callable = ParsePrimaryExpression();
+  if (Failed()) {
+    return error_;
+  }
 
   while (Matches(lex::TokenType::LEFT_BRACE)) {
     if (Matches(lex::TokenType::RIGHT_BRACE)) {
       // No arguments
-      callable = new ast::FnCallExpression(callable, std::vector<ast::Expression*>{});
+      callable = arena_.New<ast::FnCallExpression>(callable, std::span<ast::Expression*>{});
       continue;
     }
 
     std::vector<ast::Expression*> args;
     // First argument
     args.push_back(ParseExpression());
-    while (!Matches(lex::TokenType::RIGHT_BRACE)) {
-      Consume(lex::TokenType::COMMA);
+    while (!Failed() && !Matches(lex::TokenType::RIGHT_BRACE)) {
+      if (!Consume(lex::TokenType::COMMA)) {
+        return error_;
+      }
       args.push_back(ParseExpression());
     }
 
-    callable = new ast::FnCallExpression(callable, std::move(args));
+    if (Failed()) {
+      return error_;
+    }
+
+    callable = arena_.New<ast::FnCallExpression>(callable, arena_.NewArray(args));
   }
 
   return callable;
@@ -164,7 +232,10 @@ ast::Expression* parse::Parser::ParsePrimaryExpression() {
 
   if (Matches(lex::TokenType::LEFT_BRACE)) {
     ast::Expression *expr = ParseExpression();
-    Consume(lex::TokenType::RIGHT_BRACE);
+    if (Failed() || !Consume(lex::TokenType::RIGHT_BRACE)) {
+      return error_;
+    }
+
     return expr;
   }
 
@@ -179,18 +250,18 @@ ast::Expression* parse::Parser::ParsePrimaryExpression() {
 
   // Then all the base cases: IDENT, INT, TRUE, FALSE, ETC...
 
-  lex::Token curr_token = lexer_.Peek();
+  lex::Token curr_token = Peek();
   switch (curr_token.type) {
     case lex::TokenType::IDENTIFIER:
     case lex::TokenType::NUMBER:
     case lex::TokenType::STRING:
     case lex::TokenType::TRUE:
     case lex::TokenType::FALSE:
-      lexer_.Advance();
-      return new ast::LiteralExpression(curr_token);
+      Advance();
+      return arena_.New<ast::LiteralExpression>(curr_token);
 
     default:
-      throw parse::errors::ParsePrimaryError(curr_token.location.Format());
+      return Fail(parse::errors::ParsePrimaryError(FormatLocation(curr_token.GetLocation())));
   }
 
   FMT_ASSERT(false, "Unreachable!");
@@ -203,10 +274,14 @@ ast::Expression* parse::Parser::ParseReturnExpression() {
     return nullptr;
   }
 
-  lex::Token return_token = lexer_.GetPreviousToken();
+  lex::Token return_token = GetPreviousToken();
 
   ast::Expression* expr = ParseExpression();
-  return new ast::ReturnExpression(return_token, expr);
+  if (Failed()) {
+    return error_;
+  }
+
+  return arena_.New<ast::ReturnExpression>(return_token, expr);
 }
 
 ///////////////////////////////////////////////////////////////////
@@ -216,10 +291,369 @@ ast::Expression* parse::Parser::ParseYieldExpression() {
     return nullptr;
   }
 
-  lex::Token yield_token = lexer_.GetPreviousToken();
+  lex::Token yield_token = GetPreviousToken();
 
   ast::Expression* expr = ParseExpression();
-  return new ast::YieldExpression(yield_token, expr);
+  if (Failed()) {
+    return error_;
+  }
+
+  return arena_.New<ast::YieldExpression>(yield_token, expr);
 }
 
 ///////////////////////////////////////////////////////////////////
+
+namespace {
+
+// Constructs the iterative parser is inside of, each waits for the
+// expression being parsed
+enum class Pending : uint8_t {
+  Unary,      // token = operator
+  Infix,      // token = operator, lhs, stage = precedence
+  Group,
+  Call,       // lhs = callable, arguments so far from `items` on
+  If,         // token = 'if', stage 0..2 = condition, then, else
+              // lhs = condition, rhs = then branch
+  Return,     // token = keyword
+  Yield,      // token = keyword
+  Block,      // token = '{', statements so far from `items` on,
+              // stage = whether some of them threw
+  Statement,  // stage 0 = expression, 1 = assigned value after lhs
+  VarDecl,    // token = name, type
+  FunDecl,    // type, head at `items`
+};
+
+struct Frame {
+  Pending kind;
+  uint8_t stage = 0;
+  lex::Token token{};
+  ast::Expression* lhs = nullptr;
+  ast::Expression* rhs = nullptr;
+  types::Type* type = nullptr;
+  size_t items = 0;
+};
+
+enum class Step : uint8_t {
+  // Prefix operators, then a primary expression
+  Operand,
+  // A primary is in `value`: calls, then the pending operators, then
+  // whatever waits for the expression
+  Postfix,
+  // Top of the stack is a block: the next statement or the '}'
+  Statement,
+};
+
+template <typename T>
+std::vector<T> TakeFrom(std::vector<T>& items, size_t begin) {
+  std::vector<T> tail(items.begin() + begin, items.end());
+  items.resize(begin);
+  return tail;
+}
+
+}  // namespace
+
+// The recursive descent above unrolled: every function call that may
+// nest is a Frame, each iteration does what the recursive parser does
+// between two such calls. Failures unwind to the nearest block, as the
+// try/catch and Failed() checks there do
+ast::Expression* parse::Parser::ParseExpressionIteratively() {
+  std::vector<Frame> frames;
+  // Items of Call, Block and FunDecl frames, nested frames add theirs on top
+  std::vector<ast::Expression*> args;
+  std::vector<ast::Statement*> statements;
+  std::vector<FunDeclHead> heads;
+
+  Step step = Step::Operand;
+  ast::Expression* value = nullptr;
+
+  // Drops the frames above the innermost block, and that block too if the
+  // failure is its own, not one of its statements'. False if none is left
+  auto unwind = [&](bool block_failed) {
+    if (block_failed) {
+      statements.resize(frames.back().items);
+      frames.pop_back();
+    }
+
+    while (!frames.empty() && frames.back().kind != Pending::Block) {
+      Frame& frame = frames.back();
+      if (frame.kind == Pending::Call) {
+        args.resize(frame.items);
+      } else if (frame.kind == Pending::FunDecl) {
+        heads.pop_back();
+      }
+      frames.pop_back();
+    }
+
+    return !frames.empty();
+  };
+
+  while (true) {
+    bool block_failed = false;
+
+    try {
+      switch (step) {
+        case Step::Operand: {
+          lex::Token token = Peek();
+
+          if (Matches(lex::TokenType::MINUS) || Matches(lex::TokenType::NOT)) {
+            frames.push_back(Frame{.kind = Pending::Unary, .token = token});
+          } else if (Matches(lex::TokenType::LEFT_BRACE)) {
+            frames.push_back(Frame{.kind = Pending::Group});
+          } else if (Matches(lex::TokenType::LEFT_CBRACE)) {
+            frames.push_back(Frame{.kind = Pending::Block, .token = token, .items = statements.size()});
+            step = Step::Statement;
+          } else if (Matches(lex::TokenType::RETURN)) {
+            frames.push_back(Frame{.kind = Pending::Return, .token = token});
+          } else if (Matches(lex::TokenType::YIELD)) {
+            frames.push_back(Frame{.kind = Pending::Yield, .token = token});
+          } else if (Matches(lex::TokenType::IF)) {
+            frames.push_back(Frame{.kind = Pending::If, .token = token});
+          } else {
+            switch (token.type) {
+              case lex::TokenType::IDENTIFIER:
+              case lex::TokenType::NUMBER:
+              case lex::TokenType::STRING:
+              case lex::TokenType::TRUE:
+              case lex::TokenType::FALSE:
+                Advance();
+                value = arena_.New<ast::LiteralExpression>(token);
+                step = Step::Postfix;
+                break;
+
+              default:
+                Fail(parse::errors::ParsePrimaryError(FormatLocation(token.GetLocation())));
+                break;
+            }
+          }
+          break;
+        }
+
+        case Step::Postfix: {
+          if (Matches(lex::TokenType::LEFT_BRACE)) {
+            if (Matches(lex::TokenType::RIGHT_BRACE)) {
+              value = arena_.New<ast::FnCallExpression>(value, std::span<ast::Expression*>{});
+            } else {
+              frames.push_back(Frame{.kind = Pending::Call, .lhs = value, .items = args.size()});
+              step = Step::Operand;
+            }
+            break;
+          }
+
+          while (!frames.empty() && frames.back().kind == Pending::Unary) {
+            value = arena_.New<ast::UnaryExpression>(frames.back().token, value);
+            frames.pop_back();
+          }
+
+          // Precedence climbing: an Infix frame is a ParseInfixExpression()
+          // waiting for its rhs, which takes operators binding tighter
+          InfixOperator op = kInfixOperators[size_t(PeekType())];
+          auto in_infix = [&]() {
+            return !frames.empty() && frames.back().kind == Pending::Infix;
+          };
+          auto min_precedence = [&]() -> uint8_t {
+            return in_infix() ? frames.back().stage + 1 : 1;
+          };
+
+          while (in_infix() && op.precedence < min_precedence()) {
+            Frame& frame = frames.back();
+            if (kInfixOperators[size_t(frame.token.type)].node == InfixNode::Comparison) {
+              value = arena_.New<ast::ComparisonExpression>(frame.token, frame.lhs, value);
+            } else {
+              value = arena_.New<ast::BinaryExpression>(frame.token, frame.lhs, value);
+            }
+            frames.pop_back();
+          }
+
+          if (op.precedence >= min_precedence()) {
+            lex::Token operation = Peek();
+            Advance();
+            frames.push_back(Frame{.kind = Pending::Infix, .stage = op.precedence,
+                                   .token = operation, .lhs = value});
+            step = Step::Operand;
+            break;
+          }
+
+          // The expression is complete
+          if (frames.empty()) {
+            return value;
+          }
+
+          Frame& frame = frames.back();
+          switch (frame.kind) {
+            case Pending::Group:
+              if (Consume(lex::TokenType::RIGHT_BRACE)) {
+                frames.pop_back();
+              }
+              break;
+
+            case Pending::Call:
+              args.push_back(value);
+              if (Matches(lex::TokenType::RIGHT_BRACE)) {
+                value = arena_.New<ast::FnCallExpression>(
+                    frame.lhs, arena_.NewArray(TakeFrom(args, frame.items)));
+                frames.pop_back();
+              } else if (Consume(lex::TokenType::COMMA)) {
+                step = Step::Operand;
+              }
+              break;
+
+            case Pending::If:
+              if (frame.stage == 0) {
+                if (Consume(lex::TokenType::THEN)) {
+                  frame.lhs = value;
+                  frame.stage = 1;
+                  step = Step::Operand;
+                }
+              } else if (frame.stage == 1 && Matches(lex::TokenType::ELSE)) {
+                frame.rhs = value;
+                frame.stage = 2;
+                step = Step::Operand;
+              } else {
+                value = frame.stage == 1
+                    ? arena_.New<ast::IfExpression>(frame.token, frame.lhs, value, nullptr)
+                    : arena_.New<ast::IfExpression>(frame.token, frame.lhs, frame.rhs, value);
+                frames.pop_back();
+              }
+              break;
+
+            case Pending::Return:
+              value = arena_.New<ast::ReturnExpression>(frame.token, value);
+              frames.pop_back();
+              break;
+
+            case Pending::Yield:
+              value = arena_.New<ast::YieldExpression>(frame.token, value);
+              frames.pop_back();
+              break;
+
+            case Pending::Statement:
+              if (frame.stage == 0 && Matches(lex::TokenType::ASSIGN)) {
+                frame.token = GetPreviousToken();
+                frame.lhs = value;
+                frame.stage = 1;
+                step = Step::Operand;
+              } else if (Consume(lex::TokenType::SEMICOLON)) {
+                if (frame.stage == 0) {
+                  statements.push_back(arena_.New<ast::ExprStatement>(value));
+                } else {
+                  statements.push_back(
+                      arena_.New<ast::AssignmentStatement>(frame.token, frame.lhs, value));
+                }
+                frames.pop_back();
+                step = Step::Statement;
+              }
+              break;
+
+            case Pending::VarDecl:
+              if (auto decl = FinishVarDecl(frame.type, frame.token, value)) {
+                statements.push_back(decl);
+                frames.pop_back();
+                step = Step::Statement;
+              }
+              break;
+
+            case Pending::FunDecl:
+              if (auto decl = FinishFunDecl(frame.type, heads.back(), value)) {
+                statements.push_back(decl);
+                heads.pop_back();
+                frames.pop_back();
+                step = Step::Statement;
+              }
+              break;
+
+            default:
+              FMT_ASSERT(false, "Unary, Infix and Block frames do not take expressions\n");
+          }
+          break;
+        }
+
+        case Step::Statement: {
+          // Errors in '}' or its absence belong to the block itself
+          block_failed = true;
+          Frame& block = frames.back();
+
+          if (Matches(lex::TokenType::RIGHT_CBRACE)) {
+            if (block.stage != 0) {
+              throw parse::errors::ParseCompoundError(FormatLocation(block.token.GetLocation()));
+            }
+
+            value = arena_.New<ast::BlockExpression>(
+                arena_.NewArray(TakeFrom(statements, block.items)));
+            frames.pop_back();
+            step = Step::Postfix;
+            break;
+          }
+
+          if (PeekType() == lex::TokenType::TOKEN_EOF) {
+            // Unterminated block, there is nothing to synchronize on
+            (void)Consume(lex::TokenType::RIGHT_CBRACE);
+            break;
+          }
+
+          block_failed = false;
+
+          types::Type* type = ParseSignature();
+          if (Failed()) {
+            break;
+          }
+
+          if (type == nullptr) {
+            frames.push_back(Frame{.kind = Pending::Statement});
+            step = Step::Operand;
+            break;
+          }
+
+          lex::Token var_name;
+          if (ParseVarDeclHead(&var_name)) {
+            frames.push_back(Frame{.kind = Pending::VarDecl, .token = var_name, .type = type});
+            step = Step::Operand;
+            break;
+          }
+
+          FunDeclHead head;
+          if (!Failed() && ParseFunDeclHead(&head)) {
+            if (lazy_ != nullptr) {
+              SkipBody();
+              if (auto decl = FinishFunDecl(type, head, nullptr)) {
+                statements.push_back(decl);
+              }
+              break;
+            }
+
+            heads.push_back(std::move(head));
+            frames.push_back(Frame{.kind = Pending::FunDecl, .type = type});
+            step = Step::Operand;
+            break;
+          }
+
+          if (!Failed()) {
+            Fail(parse::errors::ParseDeclarationError(FormatLocation()));
+          }
+          break;
+        }
+      }
+    } catch (parse::errors::ParseError& error) {
+      if (!unwind(block_failed)) {
+        throw;
+      }
+
+      ReportError(error);
+      Synchronize();
+      frames.back().stage = 1;
+      step = Step::Statement;
+      continue;
+    }
+
+    if (Failed()) {
+      if (!unwind(block_failed)) {
+        return error_;
+      }
+
+      Recover();
+      statements.push_back(FailedStatement());
+      step = Step::Statement;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////
@@ -5,16 +5,25 @@
 
 ast::Statement* parse::Parser::ParseStatement() {
   ast::Expression* expr = ParseExpression();
+  if (Failed()) {
+    return FailedStatement();
+  }
 
   if (Matches(lex::TokenType::ASSIGN)) {
     // Assignment statement
-    lex::Token assn_token = lexer_.GetPreviousToken();
+    lex::Token assn_token = GetPreviousToken();
     ast::Expression* value = ParseExpression();
-    Consume(lex::TokenType::SEMICOLON);
-    return new ast::AssignmentStatement(assn_token, expr, value);
+    if (Failed() || !Consume(lex::TokenType::SEMICOLON)) {
+      return FailedStatement();
+    }
+
+    return arena_.New<ast::AssignmentStatement>(assn_token, expr, value);
   }
 
   // Expression statement
-  Consume(lex::TokenType::SEMICOLON);
-  return new ast::ExprStatement(expr);
+  if (!Consume(lex::TokenType::SEMICOLON)) {
+    return FailedStatement();
+  }
+
+  return arena_.New<ast::ExprStatement>(expr);
 }
\ No newline at end of file
@@ -2,67 +2,84 @@
 #include <types/primitive_types.hpp>
 
 types::Type* parse::Parser::ParsePrimitiveType() {
-  lex::Token next_token = lexer_.Peek();
+  lex::Token next_token = Peek();
   switch (next_token.type) {
     case lex::TokenType::TY_UNIT:
-      lexer_.Advance();
+      Advance();
       return &types::PrimitiveType::unit_type;
 
     case lex::TokenType::TY_INT:
-      lexer_.Advance();
+      Advance();
       return &types::PrimitiveType::int_type;
 
     case lex::TokenType::TY_STRING:
-      lexer_.Advance();
+      Advance();
       return &types::PrimitiveType::string_type;
 
     case lex::TokenType::TY_BOOL:
-      lexer_.Advance();
+      Advance();
       return &types::PrimitiveType::bool_type;
 
     case lex::TokenType::NOT:
-      lexer_.Advance();
+      Advance();
       return nullptr; // ???
 
     case lex::TokenType::LEFT_BRACE:
-      lexer_.Advance();
-      Consume(lex::TokenType::RIGHT_BRACE);
+      Advance();
+      if (!Consume(lex::TokenType::RIGHT_BRACE)) {
+        return nullptr;
+      }
       return nullptr; // ???
 
     default:
-      throw parse::errors::ParseTypeError(next_token.location.Format());
+      Fail(parse::errors::ParseTypeError(FormatLocation(next_token.GetLocation())));
+      return nullptr;
   }
 }
 
 types::Type* parse::Parser::ParseType() {
-  if (!lexer_.Matches(lex::TokenType::LEFT_SBRACE)) {
+  if (!Matches(lex::TokenType::LEFT_SBRACE)) {
     return ParseSimpleType();
   }
 
   std::vector<types::Type*> args;
   if (!Matches(lex::TokenType::RIGHT_SBRACE)) {
     args.push_back(ParseType());
-    while (!Matches(lex::TokenType::RIGHT_SBRACE)) {
-      Consume(lex::TokenType::COMMA);
+    while (!Failed() && !Matches(lex::TokenType::RIGHT_SBRACE)) {
+      if (!Consume(lex::TokenType::COMMA)) {
+        return nullptr;
+      }
       args.push_back(ParseType());
     }
   }
 
-  Consume(lex::TokenType::ARROW);
+  if (Failed() || !Consume(lex::TokenType::ARROW)) {
+    return nullptr;
+  }
+
   types::Type *return_type = ParseType();
-  return type_keeper_.CreateType<types::FunctionType>(return_type, std::move(args));
+  if (Failed()) {
+    return nullptr;
+  }
+
+  return type_keeper_.GetFunctionType(return_type, std::move(args));
 }
 
 types::Type* parse::Parser::ParseSimpleType() {
-  if (lexer_.Matches(lex::TokenType::STAR)) {
-    return type_keeper_.CreateType<types::PointerType>(ParseSimpleType());
+  if (Matches(lex::TokenType::STAR)) {
+    types::Type* pointee = ParseSimpleType();
+    if (Failed()) {
+      return nullptr;
+    }
+
+    return type_keeper_.GetPointerType(pointee);
   }
 
   return ParsePrimitiveType();
 }
 
 types::Type* parse::Parser::ParseSignature() {
-  if (!lexer_.Matches(lex::TokenType::OF)) {
+  if (!Matches(lex::TokenType::OF)) {
     return nullptr;
   }
 
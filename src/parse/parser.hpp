@@ -1,21 +1,81 @@
 #pragma once
 
+#include <ast/arena.hpp>
 #include <ast/declarations.hpp>
 #include <types/type.hpp>
+#include <types/type_context.hpp>
 #include <parse/parse_error.hpp>
 #include <lex/lexer.hpp>
-#include <utils/storage.hpp>
+#include <lex/token_stream.hpp>
+#include <utils/thread_pool.hpp>
+
+#include <algorithm>
+#include <mutex>
 #include <utility>
 
-// TODO: handle lifetime of scopes and AST nodes
+// TODO: handle lifetime of scopes
 
 namespace parse {
-class Parser {
+
+enum class ErrorMode {
+  // Syntax errors are thrown as parse::errors::ParseError
+  Throw,
+  // Errors are collected without unwinding: a broken statement or
+  // declaration becomes an ast::ErrorStatement and parsing goes on
+  Recover,
+};
+
+class Parser : public ast::BodyParser {
  public:
-  explicit Parser(lex::Lexer& lexer, utils::Storage<types::Type>& type_keeper);
+  // Every node is allocated from `arena`, which owns the resulting tree
+  Parser(lex::Lexer& lexer, types::TypeContext& type_keeper,
+         ast::Arena& arena, ErrorMode mode = ErrorMode::Throw);
+
+  // Walks a pre-lexed stream by index instead of pulling from a Lexer,
+  // starting at its current position. The stream's own cursor is not moved
+  Parser(const lex::TokenStream& stream, types::TypeContext& type_keeper,
+         ast::Arena& arena, ErrorMode mode = ErrorMode::Throw);
+
+  // Sees only the tokens [begin; end) of `stream`, end reads as TOKEN_EOF
+  Parser(const lex::TokenStream& stream, size_t begin, size_t end,
+         types::TypeContext& type_keeper, ast::Arena& arena,
+         ErrorMode mode = ErrorMode::Throw);
+
+  // Errors met so far in ErrorMode::Recover
+  const std::vector<errors::ParseError>& GetErrors() const {
+    return errors_;
+  }
 
   ast::Program* ParseProgram();
 
+  // Same tree, errors and types as ParseProgram(), built on `pool`.
+  // Needs a token stream: top-level declarations are split at each ';'
+  // outside of braces, and batches of them are parsed into arenas of
+  // their own which are absorbed into ours in source order. Everything
+  // from the first batch with a syntax error on is parsed serially
+  // again, as recovery there may not stop at the split
+  ast::Program* ParseProgram(utils::ThreadPool& pool);
+
+  // Stream mode only. Function bodies are skipped up to the ';' ending
+  // their declaration and parsed on the first FunDeclStatement::GetBody(),
+  // for clients which only need the signatures. The parser, stream and
+  // arena must outlive the tree then. Bodies may be forced from several
+  // threads, one at a time
+  void SetLazyBodies(bool lazy) {
+    FMT_ASSERT(stream_ != nullptr, "Lazy bodies need a token stream\n");
+    lazy_ = lazy ? this : nullptr;
+  }
+
+  ast::Expression* ParseBody(size_t begin, size_t end) override;
+
+  // Expressions, blocks and the statements in them are parsed by a loop
+  // over an explicit stack instead of recursive descent, so nesting depth
+  // (else-if ladders, long operator chains, nested blocks) is bounded by
+  // memory rather than by the call stack. Same trees and errors
+  void SetIterative(bool iterative) {
+    iterative_ = iterative;
+  }
+
   ///////////////////////////////////////////////////////////////////
 
   ast::Statement* ParseStatement();
@@ -27,6 +87,9 @@ class Parser {
   ast::FunDeclStatement* ParseFunDeclStatement(types::Type* type);
   ast::VarDeclStatement* ParseVarDeclStatement(types::Type* type);
 
+  // See SetIterative()
+  ast::Expression* ParseExpressionIteratively();
+
   ////////////////////////////////////////////////////////////////////
 
   ast::Expression* ParseExpression();
@@ -39,35 +102,15 @@ class Parser {
 
   ast::Expression* ParseCompoundExpression();
 
-  // Precedences
-  ast::Expression* ParseEqualityExpression();
-  ast::Expression* ParseRelationalExpression();
-  ast::Expression* ParseAdditiveExpression();
-  ast::Expression* ParseMultiplicativeExpression();
+  // Binary operators binding at least as tight as `min_precedence`,
+  // see the operator table in parse_expr.cpp
+  ast::Expression* ParseInfixExpression(uint8_t min_precedence);
   ast::Expression* ParsePostfixExpression();
   ast::Expression* ParseUnaryExpression();
   ast::Expression* ParsePrimaryExpression();
 
   ////////////////////////////////////////////////////////////////////
 
-  template<
-      ast::Expression* (Parser::*InnerParser)(),
-      typename ResultNode,
-      lex::TokenType... Tokens
-      >
-  ast::Expression* ParseBinaryExpression() {
-    ast::Expression *lhs = (this->*InnerParser)();
-
-    while ((Matches(Tokens) || ...)) {
-      lex::Token operation = lexer_.GetPreviousToken();
-      lhs = new ResultNode(operation, lhs, (this->*InnerParser)());
-    }
-
-    return lhs;
-  }
-
-  ////////////////////////////////////////////////////////////////////
-
   types::Type* ParsePrimitiveType();
   types::Type* ParseSimpleType();
   types::Type* ParseType();
@@ -76,23 +119,151 @@ class Parser {
 
  private:
   std::string FormatLocation() {
-    return lexer_.Peek().location.Format();
+    return FormatLocation(PeekLocation());
+  }
+
+  std::string FormatLocation(lex::Location location) const {
+    return location.Format(sources_);
   }
 
   std::vector<lex::Token> ParseFunctionArgs();
 
+  // Declarations are split around their initializer or body, so the
+  // iterative parser can put them on its stack
+
+  // `var name =`, false if there is no `var` or on failure
+  bool ParseVarDeclHead(lex::Token* name);
+  ast::VarDeclStatement* FinishVarDecl(types::Type* type, lex::Token name,
+                                       ast::Expression* value);
+
+  struct FunDeclHead {
+    lex::Location location;
+    lex::Token name;
+    std::vector<lex::Token> params;
+    size_t body_begin = 0;
+  };
+
+  // `fun name(params) =`, false if there is no `fun` or on failure
+  bool ParseFunDeclHead(FunDeclHead* head);
+  ast::FunDeclStatement* FinishFunDecl(types::Type* type, FunDeclHead& head,
+                                       ast::Expression* body);
+
+  // Moves to the ';' ending the current declaration
+  void SkipBody();
+
+  ////////////////////////////////////////////////////////////////////
+
+  // Token cursor over either the streaming lexer or the token stream
+
+  lex::Token Peek() {
+    if (stream_ == nullptr) {
+      return lexer_->Peek();
+    }
+
+    return pos_ < end_ ? stream_->GetToken(pos_)
+                       : lex::Token(lex::TokenType::TOKEN_EOF, PeekLocation());
+  }
+
+  lex::TokenType PeekType() {
+    if (stream_ == nullptr) {
+      return lexer_->PeekType();
+    }
+
+    return pos_ < end_ ? stream_->GetType(pos_) : lex::TokenType::TOKEN_EOF;
+  }
+
+  lex::Location PeekLocation() {
+    return stream_ != nullptr ? stream_->GetLocation(std::min(pos_, end_))
+                              : lexer_->Peek().GetLocation();
+  }
+
+  lex::Token GetPreviousToken() {
+    if (stream_ == nullptr) {
+      return lexer_->GetPreviousToken();
+    }
+
+    return pos_ == 0 ? lex::Token{} : stream_->GetToken(pos_ - 1);
+  }
+
+  void Advance() {
+    if (stream_ == nullptr) {
+      lexer_->Advance();
+    } else if (pos_ < end_) {
+      pos_++;
+    }
+  }
+
   bool Matches(lex::TokenType type) {
-    return lexer_.Matches(type);
+    if (stream_ == nullptr) {
+      return lexer_->Matches(type);
+    }
+
+    if (PeekType() == type) {
+      Advance();
+      return true;
+    }
+
+    return false;
   }
 
-  void Consume(lex::TokenType type);
+  // False (or a throw) if the next token is not of `type`
+  [[nodiscard]] bool Consume(lex::TokenType type);
   static void ReportError(const errors::ParseError& error);
 
+  ////////////////////////////////////////////////////////////////////
+
+  // Error recovery without exceptions. Fail() records the error and marks
+  // the parser as failed, every caller checks Failed() after a nested
+  // parse and returns at once, up to the nearest statement list. There
+  // Recover() skips to the next statement and clears the mark
+
+  template <typename Error>
+  ast::ErrorExpression* Fail(Error error) {
+    if (mode_ == ErrorMode::Throw) {
+      throw error;
+    }
+
+    errors_.push_back(std::move(error));
+    failed_ = true;
+    error_ = arena_.New<ast::ErrorExpression>(PeekLocation());
+    return error_;
+  }
+
+  bool Failed() const {
+    return failed_;
+  }
+
+  // Stand-in for the statement being parsed when Failed()
+  ast::ErrorStatement* FailedStatement() {
+    return arena_.New<ast::ErrorStatement>(error_->GetLocation());
+  }
+
+  void Recover();
+
   /// Skips tokens until semicolon or EOF is encountered
   void Synchronize();
 
  private:
-  lex::Lexer& lexer_;
-  utils::Storage<types::Type>& type_keeper_;
+  lex::Lexer* lexer_ = nullptr;
+  const lex::TokenStream* stream_ = nullptr;
+  // Stream mode cursor, tokens from end_ on read as TOKEN_EOF
+  size_t pos_ = 0;
+  size_t end_ = 0;
+  // Of the lexer or the stream, decodes locations of errors
+  const lex::SourceTable& sources_;
+  types::TypeContext& type_keeper_;
+  ast::Arena& arena_;
+
+  // Parser which forces lazy bodies, null if they are parsed right away
+  ast::BodyParser* lazy_ = nullptr;
+  bool iterative_ = false;
+
+  ErrorMode mode_;
+  std::vector<errors::ParseError> errors_;
+  // Serializes ParseBody, which adds to the arena and errors_
+  std::mutex body_mutex_;
+  bool failed_ = false;
+  // Placeholder made by the last Fail()
+  ast::ErrorExpression* error_ = nullptr;
 };
 }  // namespace parse
@@ -2,20 +2,36 @@
 #include <parse/parser.hpp>
 #include <errors/error_handler.hpp>
 
-parse::Parser::Parser(lex::Lexer& lexer, utils::Storage<types::Type>& type_keeper) :
-      lexer_{lexer}, type_keeper_{type_keeper} {
+parse::Parser::Parser(lex::Lexer& lexer, types::TypeContext& type_keeper,
+                      ast::Arena& arena, ErrorMode mode) :
+      lexer_{&lexer}, sources_{lexer.GetSources()}, type_keeper_{type_keeper}, arena_{arena}, mode_{mode} {
 }
 
-void parse::Parser::Consume(lex::TokenType type) {
-  if (!Matches(type)) {
-    throw parse::errors::ParseTokenError(lex::FormatTokenType(type), FormatLocation());
+parse::Parser::Parser(const lex::TokenStream& stream,
+                      types::TypeContext& type_keeper,
+                      ast::Arena& arena, ErrorMode mode) :
+      Parser(stream, stream.GetPosition(), stream.Size() - 1, type_keeper, arena, mode) {
+}
+
+parse::Parser::Parser(const lex::TokenStream& stream, size_t begin, size_t end,
+                      types::TypeContext& type_keeper,
+                      ast::Arena& arena, ErrorMode mode) :
+      stream_{&stream}, pos_{begin}, end_{end}, sources_{stream.GetSources()},
+      type_keeper_{type_keeper}, arena_{arena}, mode_{mode} {
+}
+
+bool parse::Parser::Consume(lex::TokenType type) {
+  if (Matches(type)) {
+    return true;
   }
+
+  Fail(parse::errors::ParseTokenError(lex::FormatTokenType(type), FormatLocation()));
+  return false;
 }
 
 void parse::Parser::ReportError(const parse::errors::ParseError& error) {
   // TODO: normal errors printing
-  if (dynamic_cast<const parse::errors::ParseCompoundError*>(&error) != nullptr) {
-    // ew
+  if (error.compound) {
     return;
   }
 
@@ -23,13 +39,18 @@ void parse::Parser::ReportError(const parse::errors::ParseError& error) {
 }
 
 void parse::Parser::Synchronize() {
-  lexer_.Advance();
-
-  while (lexer_.Peek().type != lex::TokenType::TOKEN_EOF) {
-    if (lexer_.Matches(lex::TokenType::SEMICOLON)) {
+  // The error may sit right on the semicolon, which then ends the
+  // broken statement, do not skip over the next one
+  while (PeekType() != lex::TokenType::TOKEN_EOF) {
+    if (Matches(lex::TokenType::SEMICOLON)) {
       return;
     }
 
-    lexer_.Advance();
+    Advance();
   }
 }
+
+void parse::Parser::Recover() {
+  Synchronize();
+  failed_ = false;
+}
@@ -1,24 +1,31 @@
 #pragma once
 
 #include <ast/declarations.hpp>
-#include <ast/visitors/base_visitor.hpp>
+#include <ast/visitors/static_visitor.hpp>
 #include <ast/symbol/symbol_error.hpp>
 
 namespace passes {
-/// Builds symbol table and checks for definitions
-class DefinitionChecker : public ast::BaseVisitor {
+/// Binds every identifier to its symbol and checks for definitions.
+/// Later passes read LiteralExpression::symbol and never walk scopes
+class DefinitionChecker : public ast::StaticVisitor<DefinitionChecker> {
  public:
-  void VisitLiteralExpression(ast::LiteralExpression* expr) override {
+  // Names and locations of errors are decoded through `sources`
+  explicit DefinitionChecker(const lex::SourceTable& sources) : sources_{sources} {
+  }
+
+  void EnterLiteralExpression(ast::LiteralExpression* expr) {
     if (expr->literal_.type == lex::TokenType::IDENTIFIER) {
-      ast::Symbol* symbol = expr->scope->Lookup(expr->literal_.GetIdentifier(),
-                                                expr->literal_.location);
-      if (symbol == nullptr) {
+      expr->symbol = expr->scope->Lookup(expr->literal_.GetSymbolId(),
+                                         expr->literal_.GetLocation());
+      if (expr->symbol == nullptr) {
         throw ast::errors::UndefinedSymbolError(
-            expr->literal_.GetIdentifier(), expr->literal_.location.Format());
+            expr->literal_.GetIdentifier(sources_),
+            expr->literal_.GetLocation().Format(sources_));
       }
     }
-
-    BaseVisitor::VisitLiteralExpression(expr);
   }
+
+ private:
+  const lex::SourceTable& sources_;
 };
 }  // namespace passes
\ No newline at end of file
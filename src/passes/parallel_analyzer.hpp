@@ -0,0 +1,98 @@
+#pragma once
+
+#include <ast/arena.hpp>
+#include <ast/declarations.hpp>
+#include <ast/visitors/fused_visitor.hpp>
+#include <passes/definition_checker.hpp>
+#include <passes/symbol_table_builder.hpp>
+#include <passes/type_evaluator.hpp>
+#include <utils/thread_pool.hpp>
+
+#include <algorithm>
+#include <exception>
+#include <vector>
+
+namespace passes {
+
+/// SymbolTableBuilder, DefinitionChecker and TypeEvaluator run fused on
+/// every top-level declaration, the declarations spread over a pool.
+/// Globals are declared up front. Then a declaration only reads them and
+/// writes its own nodes, its locals and scopes are its own.
+///
+/// Each declaration keeps its first error. Analyze() rethrows the error
+/// the single fused walk would: an earlier pass wins, then an earlier
+/// declaration. The outcome does not depend on the scheduling
+class ParallelAnalyzer {
+ public:
+  struct DeclarationError {
+    size_t decl = 0;
+    // Index of the failed pass, in the order listed above
+    size_t pass = 0;
+    std::exception_ptr error;
+  };
+
+  // Symbols of the locals are placed in `arena`, with the tree
+  ParallelAnalyzer(ast::Arena& arena, const lex::SourceTable& sources, utils::ThreadPool& pool)
+      : arena_{arena}, sources_{sources}, pool_{pool} {
+  }
+
+  void Analyze(ast::Program* prg) {
+    SymbolTableBuilder globals(arena_, sources_);
+    globals.DeclareGlobals(prg);
+
+    // Few declarations per task are not worth a thread hop, and every
+    // batch needs an arena of its own
+    size_t count = prg->decls_.size();
+    size_t batches = (count + kBatchDecls - 1) / kBatchDecls;
+
+    std::vector<ast::Arena> arenas(batches);
+    std::vector<std::vector<DeclarationError>> batch_errors(batches);
+
+    pool_.ParallelFor(batches, [&](size_t batch) {
+      size_t end = std::min(count, (batch + 1) * kBatchDecls);
+      for (size_t i = batch * kBatchDecls; i < end; i++) {
+        SymbolTableBuilder builder(arenas[batch], sources_, prg->scope);
+        DefinitionChecker checker(sources_);
+        TypeEvaluator type_evaluator(sources_);
+        ast::FusedVisitor analysis(builder, checker, type_evaluator);
+
+        try {
+          prg->decls_[i]->Accept(&analysis);
+        } catch (const ::errors::CompileError&) {
+          batch_errors[batch].push_back(DeclarationError{
+              .decl = i, .pass = analysis.GetFailedPass(), .error = std::current_exception()});
+        }
+      }
+    });
+
+    errors_.clear();
+    for (size_t batch = 0; batch < batches; batch++) {
+      arena_.Absorb(arenas[batch]);
+      errors_.insert(errors_.end(), batch_errors[batch].begin(), batch_errors[batch].end());
+    }
+
+    if (errors_.empty()) {
+      return;
+    }
+
+    auto first = std::min_element(errors_.begin(), errors_.end(), [](auto& lhs, auto& rhs) {
+      return lhs.pass < rhs.pass || (lhs.pass == rhs.pass && lhs.decl < rhs.decl);
+    });
+    std::rethrow_exception(first->error);
+  }
+
+  // First error of every declaration which has one, in declaration order
+  const std::vector<DeclarationError>& GetErrors() const {
+    return errors_;
+  }
+
+ private:
+  static constexpr size_t kBatchDecls = 64;
+
+  ast::Arena& arena_;
+  const lex::SourceTable& sources_;
+  utils::ThreadPool& pool_;
+  std::vector<DeclarationError> errors_;
+};
+
+}  // namespace passes
@@ -1,58 +1,89 @@
 #pragma once
 
+#include <ast/arena.hpp>
 #include <ast/declarations.hpp>
-#include <ast/visitors/base_visitor.hpp>
+#include <ast/visitors/static_visitor.hpp>
 #include <ast/symbol/symbol_error.hpp>
 
+#include <memory>
+#include <vector>
+
 namespace passes {
-class SymbolTableBuilder : public ast::BaseVisitor {
+/// Symbols are placed in the arena of the tree, so they outlive the
+/// builder. Scopes are owned by the builder and are needed only until
+/// DefinitionChecker has bound every identifier to its symbol
+class SymbolTableBuilder : public ast::StaticVisitor<SymbolTableBuilder> {
  public:
-  void VisitProgram(ast::Program* prg) override {
+  // Names of the symbols are decoded through `sources`
+  SymbolTableBuilder(ast::Arena& arena, const lex::SourceTable& sources)
+      : arena_{arena}, sources_{sources} {
+  }
+
+  // Builds the scopes of a single top-level declaration of a program
+  // whose globals are declared in `root`, see DeclareGlobals
+  SymbolTableBuilder(ast::Arena& arena, const lex::SourceTable& sources, ast::Scope* root)
+      : arena_{arena}, sources_{sources}, root_scope_{root}, current_scope_{root} {
+  }
+
+  void EnterProgram(ast::Program* prg) {
+    DeclareGlobals(prg);
+  }
+
+  // Opens the root scope of `prg`, with all of its globals declared
+  void DeclareGlobals(ast::Program* prg) {
     // Root scope
     PushScope(lex::Location{});
     // Despite convention below, set program scope as root scope
     // to give access to the root scope
     prg->scope = current_scope_;
-    BaseVisitor::VisitProgram(prg);
+    root_scope_ = current_scope_;
+
+    // Globals are visible everywhere, declare them before any body is
+    // walked. Then a pass running in the same walk can look them up
+    for (ast::Declaration* decl : prg->decls_) {
+      if (auto var = utils::dyn_cast<ast::VarDeclStatement>(decl)) {
+        current_scope_->AddSymbol(NewSymbol(var));
+      } else if (auto fun = utils::dyn_cast<ast::FunDeclStatement>(decl)) {
+        current_scope_->AddSymbol(NewSymbol(fun));
+      }
+    }
+  }
+
+  void LeaveProgram(ast::Program*) {
     PopScope();
   }
 
-  void VisitBlockExpression(ast::BlockExpression* expr) override {
+  void EnterBlockExpression(ast::BlockExpression* expr) {
     expr->scope = current_scope_;
     PushScope(expr->GetLocation());
-    BaseVisitor::VisitBlockExpression(expr);
+  }
+
+  void LeaveBlockExpression(ast::BlockExpression*) {
     PopScope();
   }
 
-  void VisitVarDeclaration(ast::VarDeclStatement* decl) override {
+  // Declared before the initializer is walked: uses in it are resolved
+  // by location, as if the whole scope were already built
+  void EnterVarDeclaration(ast::VarDeclStatement* decl) {
     decl->scope = current_scope_;
-    BaseVisitor::VisitVarDeclaration(decl);
-
-    bool success = current_scope_->AddSymbol(ast::Symbol{.type = ast::SymbolType::VarDecl,
-                                        .name = decl->GetName(),
-                                        .location = decl->GetLocation(),
-                                        .global_scope = global_scope_,
-                                        .symbol = ast::VarSymbol{ .type = decl->type_ }});
-    if (!success) {
-      throw ast::errors::RedefinitionError(decl->GetName(),
-                                          decl->GetLocation().Format());
+    if (current_scope_ != root_scope_) {
+      current_scope_->AddSymbol(NewSymbol(decl));
     }
   }
 
-  void VisitFunDeclaration(ast::FunDeclStatement* decl) override {
+  // A redefinition is reported after the initializer
+  void LeaveVarDeclaration(ast::VarDeclStatement* decl) {
+    CheckDeclared(decl->name_, decl);
+  }
+
+  void EnterFunDeclaration(ast::FunDeclStatement* decl) {
     decl->scope = current_scope_;
-    bool success = current_scope_->AddSymbol(ast::Symbol{.type = ast::SymbolType::FnDecl,
-                                        .name = decl->GetName(),
-                                        .location = decl->GetLocation(),
-                                        .global_scope = global_scope_,
-                                        .symbol = ast::FnSymbol{ .type = decl->type_ }});
-    if (!success) {
-      throw ast::errors::RedefinitionError(decl->GetName(),
-                                     decl->GetLocation().Format());
+    if (current_scope_ != root_scope_) {
+      current_scope_->AddSymbol(NewSymbol(decl));
     }
+    CheckDeclared(decl->name_, decl);
 
-    auto func_type = dynamic_cast<types::FunctionType*>(decl->type_);
-    FMT_ASSERT(func_type != nullptr, "FunDeclStatement incorrect type");
+    auto func_type = utils::cast<types::FunctionType>(decl->type_);
     auto& param_types = func_type->GetArgTypes();
 
     PushScope(decl->GetLocation());
@@ -61,77 +92,100 @@ class SymbolTableBuilder : public ast::BaseVisitor {
     for (size_t i = 0; i < decl->params_.size(); i++) {
       lex::Token& param_token = decl->params_[i];
       types::Type* param_type = param_types[i];
-      current_scope_->AddSymbol(ast::Symbol{.type = ast::SymbolType::VarDecl,
-                                      .name = param_token.GetIdentifier(),
-                                      .location = param_token.location,
+      current_scope_->AddSymbol(NewSymbol(ast::Symbol{.type = ast::SymbolType::VarDecl,
+                                      .id = param_token.GetSymbolId(),
+                                      .name = param_token.GetIdentifier(sources_),
+                                      .location = param_token.GetLocation(),
                                       .global_scope = global_scope_,
-                                      .symbol = ast::VarSymbol{ .type =  param_type }});
+                                      .symbol = ast::VarSymbol{ .type =  param_type }}));
     }
+  }
 
-    BaseVisitor::VisitFunDeclaration(decl);
+  void LeaveFunDeclaration(ast::FunDeclStatement*) {
     global_scope_ = true;
     PopScope();
   }
 
-  void VisitLiteralExpression(ast::LiteralExpression* expr) override {
+  void EnterLiteralExpression(ast::LiteralExpression* expr) {
     expr->scope = current_scope_;
-    BaseVisitor::VisitLiteralExpression(expr);
   }
 
-  void VisitComparisonExpression(ast::ComparisonExpression* expr) override {
+  void EnterComparisonExpression(ast::ComparisonExpression* expr) {
     expr->scope = current_scope_;
-    BaseVisitor::VisitComparisonExpression(expr);
   }
 
-  void VisitBinaryExpression(ast::BinaryExpression* expr) override {
+  void EnterBinaryExpression(ast::BinaryExpression* expr) {
     expr->scope = current_scope_;
-    BaseVisitor::VisitBinaryExpression(expr);
   }
 
-  void VisitUnaryExpression(ast::UnaryExpression* expr) override {
+  void EnterUnaryExpression(ast::UnaryExpression* expr) {
     expr->scope = current_scope_;
-    BaseVisitor::VisitUnaryExpression(expr);
   }
 
-  void VisitIfExpression(ast::IfExpression* expr) override {
+  void EnterIfExpression(ast::IfExpression* expr) {
     expr->scope = current_scope_;
-    BaseVisitor::VisitIfExpression(expr);
   }
 
-  void VisitFnCallExpression(ast::FnCallExpression* expr) override {
+  void EnterFnCallExpression(ast::FnCallExpression* expr) {
     expr->scope = current_scope_;
-    BaseVisitor::VisitFnCallExpression(expr);
   }
 
-  void VisitVarAccessExpression(ast::VarAccessExpression* expr) override {
+  void EnterVarAccessExpression(ast::VarAccessExpression* expr) {
     // Not used????
     expr->scope = current_scope_;
-    BaseVisitor::VisitVarAccessExpression(expr);
   }
 
-  void VisitYieldExpression(ast::YieldExpression* expr) override {
+  void EnterYieldExpression(ast::YieldExpression* expr) {
     expr->scope = current_scope_;
-    BaseVisitor::VisitYieldExpression(expr);
   }
 
-  void VisitReturnExpression(ast::ReturnExpression* expr) override {
+  void EnterReturnExpression(ast::ReturnExpression* expr) {
     expr->scope = current_scope_;
-    BaseVisitor::VisitReturnExpression(expr);
   }
 
-  void VisitExprStatement(ast::ExprStatement* stmt) override {
+  void EnterExprStatement(ast::ExprStatement* stmt) {
     stmt->scope = current_scope_;
-    BaseVisitor::VisitExprStatement(stmt);
   }
 
-  void VisitAssignmentStatement(ast::AssignmentStatement* stmt) override {
+  void EnterAssignmentStatement(ast::AssignmentStatement* stmt) {
     stmt->scope = current_scope_;
-    BaseVisitor::VisitAssignmentStatement(stmt);
   }
 
  private:
+  ast::Symbol* NewSymbol(const ast::Symbol& symbol) {
+    return arena_.New<ast::Symbol>(symbol);
+  }
+
+  ast::Symbol* NewSymbol(ast::VarDeclStatement* decl) {
+    return NewSymbol(ast::Symbol{.type = ast::SymbolType::VarDecl,
+                                 .id = decl->name_.GetSymbolId(),
+                                 .name = decl->GetName(sources_),
+                                 .location = decl->GetLocation(),
+                                 .global_scope = global_scope_,
+                                 .symbol = ast::VarSymbol{ .type = decl->type_ }});
+  }
+
+  ast::Symbol* NewSymbol(ast::FunDeclStatement* decl) {
+    return NewSymbol(ast::Symbol{.type = ast::SymbolType::FnDecl,
+                                 .id = decl->name_.GetSymbolId(),
+                                 .name = decl->GetName(sources_),
+                                 .location = decl->GetLocation(),
+                                 .global_scope = global_scope_,
+                                 .symbol = ast::FnSymbol{ .type = decl->type_ }});
+  }
+
+  // The name is taken by the first declaration in the scope
+  void CheckDeclared(const lex::Token& name, ast::Declaration* decl) {
+    ast::Symbol* symbol = current_scope_->Find(name.GetSymbolId());
+    if (!(symbol->location == decl->GetLocation())) {
+      throw ast::errors::RedefinitionError(decl->GetName(sources_),
+                                          decl->GetLocation().Format(sources_));
+    }
+  }
+
   void PushScope(lex::Location location) {
-    current_scope_ = new ast::Scope{location, current_scope_};
+    scopes_.push_back(std::make_unique<ast::Scope>(location, current_scope_));
+    current_scope_ = scopes_.back().get();
   }
 
   void PopScope() {
@@ -140,6 +194,10 @@ class SymbolTableBuilder : public ast::BaseVisitor {
   }
 
  private:
+  ast::Arena& arena_;
+  const lex::SourceTable& sources_;
+  std::vector<std::unique_ptr<ast::Scope>> scopes_;
+  ast::Scope* root_scope_ = nullptr;
   ast::Scope* current_scope_ = nullptr;
   bool global_scope_ = true;
 };
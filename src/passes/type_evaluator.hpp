@@ -1,95 +1,89 @@
 #pragma once
 
 #include <ast/declarations.hpp>
-#include <ast/visitors/base_visitor.hpp>
+#include <ast/visitors/static_visitor.hpp>
 #include <types/type_error.hpp>
 #include <types/type.hpp>
 #include <types/primitive_types.hpp>
 
+#include <vector>
+
 namespace passes {
 // Evaluates types of expressions and perform type checking
-class TypeEvaluator : public ast::BaseVisitor {
+class TypeEvaluator : public ast::StaticVisitor<TypeEvaluator> {
  public:
-  void VisitComparisonExpression(ast::ComparisonExpression* expr) override {
-    BaseVisitor::VisitComparisonExpression(expr);
+  // Locations of errors are decoded through `sources`
+  explicit TypeEvaluator(const lex::SourceTable& sources) : sources_{sources} {
+  }
 
+  void LeaveComparisonExpression(ast::ComparisonExpression* expr) {
     if (!(expr->lhs_->type->Equals(&types::PrimitiveType::int_type) &&
           expr->rhs_->type->Equals(&types::PrimitiveType::int_type))) {
-      throw types::errors::ArithmTypeError(expr->GetLocation().Format());
+      throw types::errors::ArithmTypeError(expr->GetLocation().Format(sources_));
     }
 
     expr->type = &types::PrimitiveType::bool_type;
   }
 
-  void VisitBinaryExpression(ast::BinaryExpression* expr) override {
-    BaseVisitor::VisitBinaryExpression(expr);
-
+  void LeaveBinaryExpression(ast::BinaryExpression* expr) {
     if (!(expr->lhs_->type->Equals(&types::PrimitiveType::int_type) &&
           expr->rhs_->type->Equals(&types::PrimitiveType::int_type))) {
-      throw types::errors::ArithmTypeError(expr->GetLocation().Format());
+      throw types::errors::ArithmTypeError(expr->GetLocation().Format(sources_));
     }
 
     expr->type = &types::PrimitiveType::int_type;
   }
 
-  void VisitUnaryExpression(ast::UnaryExpression* expr) override {
-    BaseVisitor::VisitUnaryExpression(expr);
-
+  void LeaveUnaryExpression(ast::UnaryExpression* expr) {
     if (!expr->expr_->type->Equals(&types::PrimitiveType::int_type)) {
-      throw types::errors::ArithmTypeError(expr->GetLocation().Format());
+      throw types::errors::ArithmTypeError(expr->GetLocation().Format(sources_));
     }
 
     expr->type = &types::PrimitiveType::int_type;
   }
 
-  void VisitIfExpression(ast::IfExpression* expr) override {
-    BaseVisitor::VisitIfExpression(expr);
-
+  void LeaveIfExpression(ast::IfExpression* expr) {
     if (!expr->condition_->type->Equals(&types::PrimitiveType::bool_type)) {
-      throw types::errors::IfConditionTypeError(expr->condition_->GetLocation().Format());
+      throw types::errors::IfConditionTypeError(expr->condition_->GetLocation().Format(sources_));
     }
 
     if (expr->else_branch_ != nullptr && !expr->then_branch_->type->Equals(expr->else_branch_->type)) {
-      throw types::errors::IfBranchesTypeError(expr->GetLocation().Format());
+      throw types::errors::IfBranchesTypeError(expr->GetLocation().Format(sources_));
     }
 
     expr->type = expr->then_branch_->type;
   }
 
-  void VisitBlockExpression(ast::BlockExpression* expr) override {
-    BaseVisitor::VisitBlockExpression(expr);
-
+  void LeaveBlockExpression(ast::BlockExpression* expr) {
     if (expr->statements_.empty()) {
       expr->type = &types::PrimitiveType::unit_type;
-    } else if (auto expr_stmt = dynamic_cast<ast::ExprStatement*>(expr->statements_.back())) {
+    } else if (auto expr_stmt = utils::dyn_cast<ast::ExprStatement>(expr->statements_.back())) {
       expr->type = expr_stmt->expr_->type;
     } else {
       expr->type = &types::PrimitiveType::unit_type;
     }
   }
 
-  void VisitFnCallExpression(ast::FnCallExpression* expr) override {
-    BaseVisitor::VisitFnCallExpression(expr);
-
-    auto func_type = dynamic_cast<types::FunctionType*>(expr->callable_->type);
+  void LeaveFnCallExpression(ast::FnCallExpression* expr) {
+    auto func_type = utils::dyn_cast<types::FunctionType>(expr->callable_->type);
     if (func_type == nullptr) {
-      throw types::errors::FnCallNonFuncTypeError(expr->GetLocation().Format());
+      throw types::errors::FnCallNonFuncTypeError(expr->GetLocation().Format(sources_));
     }
 
     if (func_type->GetArgTypes().size() != expr->args_.size()) {
-      throw types::errors::FnCallArgCountMismatchError(expr->GetLocation().Format());
+      throw types::errors::FnCallArgCountMismatchError(expr->GetLocation().Format(sources_));
     }
 
     for (size_t i = 0; i < expr->args_.size(); i++) {
       if (!func_type->GetArgTypes()[i]->Equals(expr->args_[i]->type)) {
-        throw types::errors::FnCallArgTypeMismatchError(expr->GetLocation().Format());
+        throw types::errors::FnCallArgTypeMismatchError(expr->GetLocation().Format(sources_));
       }
     }
 
     expr->type = func_type->GetReturnType();
   }
 
-  void VisitLiteralExpression(ast::LiteralExpression* expr) override {
+  void LeaveLiteralExpression(ast::LiteralExpression* expr) {
     switch (expr->literal_.type) {
       case lex::TokenType::NUMBER:
         expr->type = &types::PrimitiveType::int_type;
@@ -105,7 +99,7 @@ class TypeEvaluator : public ast::BaseVisitor {
         return;
 
       case lex::TokenType::IDENTIFIER: {
-        ast::Symbol* symbol = expr->scope->Lookup(expr->literal_.GetIdentifier(), expr->GetLocation());
+        ast::Symbol* symbol = expr->symbol;
         FMT_ASSERT(symbol != nullptr, "Unknown symbol at type evaluation stage");
 
         switch (symbol->type) {
@@ -127,68 +121,65 @@ class TypeEvaluator : public ast::BaseVisitor {
     }
   }
 
-  void VisitVarAccessExpression(ast::VarAccessExpression* expression) override {
-    BaseVisitor::VisitVarAccessExpression(expression);
+  void LeaveVarAccessExpression(ast::VarAccessExpression*) {
     // ???
     // Seems to be unused by me :)
   }
 
-  void VisitYieldExpression(ast::YieldExpression* expr) override {
-    BaseVisitor::VisitYieldExpression(expr);
+  void LeaveYieldExpression(ast::YieldExpression*) {
     // ???
     // Seems to be unused by me :)
   }
 
-  void VisitReturnExpression(ast::ReturnExpression* expr) override {
-    BaseVisitor::VisitReturnExpression(expr);
+  void LeaveReturnExpression(ast::ReturnExpression* expr) {
     if (curr_func_type_ == nullptr) {
-      throw types::errors::ReturnOutsideFnError(expr->GetLocation().Format());
+      throw types::errors::ReturnOutsideFnError(expr->GetLocation().Format(sources_));
     }
 
 
     if (!curr_func_type_->GetReturnType()->Equals(expr->expr_->type)) {
-      throw types::errors::WrongReturnTypeError(expr->GetLocation().Format());
+      throw types::errors::WrongReturnTypeError(expr->GetLocation().Format(sources_));
     }
 
     expr->type = expr->expr_->type;
   }
 
-  void VisitExprStatement(ast::ExprStatement* stmt) override {
-    BaseVisitor::VisitExprStatement(stmt);
-  }
-
-  void VisitAssignmentStatement(ast::AssignmentStatement* stmt) override {
-    BaseVisitor::VisitAssignmentStatement(stmt);
-    auto lhs_lit = dynamic_cast<ast::LiteralExpression*>(stmt->lhs_);
+  void LeaveAssignmentStatement(ast::AssignmentStatement* stmt) {
+    auto lhs_lit = utils::dyn_cast<ast::LiteralExpression>(stmt->lhs_);
     if (lhs_lit == nullptr || lhs_lit->literal_.type != lex::TokenType::IDENTIFIER) {
-      throw types::errors::BadAssignmentError(stmt->GetLocation().Format());
+      throw types::errors::BadAssignmentError(stmt->GetLocation().Format(sources_));
     }
 
-    ast::Symbol* lhs_symbol = lhs_lit->scope->Lookup(lhs_lit->literal_.GetIdentifier(), lhs_lit->GetLocation());
+    ast::Symbol* lhs_symbol = lhs_lit->symbol;
     if (lhs_symbol->type != ast::SymbolType::VarDecl) {
-      throw types::errors::NonVarAssignError(stmt->GetLocation().Format());
+      throw types::errors::NonVarAssignError(stmt->GetLocation().Format(sources_));
     }
 
     if (!stmt->rhs_->type->Equals(std::get<ast::VarSymbol>(lhs_symbol->symbol).type)) {
-      throw types::errors::AssignmentTypeMismatchError(stmt->GetLocation().Format());
+      throw types::errors::AssignmentTypeMismatchError(stmt->GetLocation().Format(sources_));
     }
   }
 
-  void VisitVarDeclaration(ast::VarDeclStatement* decl) override {
-    BaseVisitor::VisitVarDeclaration(decl);
+  void LeaveVarDeclaration(ast::VarDeclStatement* decl) {
     if (!decl->type_->Equals(decl->init_expr_->type)) {
-      throw types::errors::VarDeclInitTypeMismatchError(decl->GetLocation().Format());
+      throw types::errors::VarDeclInitTypeMismatchError(decl->GetLocation().Format(sources_));
     }
   }
 
-  void VisitFunDeclaration(ast::FunDeclStatement* decl) override {
-    types::FunctionType* old = curr_func_type_;
+  void EnterFunDeclaration(ast::FunDeclStatement* decl) {
+    outer_func_types_.push_back(curr_func_type_);
     curr_func_type_ = decl->type_;
-    BaseVisitor::VisitFunDeclaration(decl);
-    curr_func_type_ = old;
+  }
+
+  void LeaveFunDeclaration(ast::FunDeclStatement*) {
+    curr_func_type_ = outer_func_types_.back();
+    outer_func_types_.pop_back();
   }
 
  private:
+  const lex::SourceTable& sources_;
   types::FunctionType* curr_func_type_ = nullptr;
+  // Types of the enclosing functions, restored on leaving nested ones
+  std::vector<types::FunctionType*> outer_func_types_;
 };
 }  // namespace ast
\ No newline at end of file
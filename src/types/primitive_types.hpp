@@ -6,22 +6,16 @@
 namespace types {
 class PrimitiveType : public Type {
  public:
+  static constexpr TypeKind kKind = TypeKind::Primitive;
+
   PrimitiveType() = delete;
 
   std::string Format() const override {
     return FormatTokenType(type_);
   }
 
-  bool Equals(types::Type* other) const override {
-    if (auto other_prim = dynamic_cast<PrimitiveType*>(other)) {
-      return other_prim->type_ == type_;
-    }
-
-    return false;
-  }
-
  private:
-  explicit PrimitiveType(lex::TokenType type) : type_(type) {}
+  explicit PrimitiveType(lex::TokenType type) : Type(kKind), type_(type) {}
 
  public:
   static PrimitiveType int_type;
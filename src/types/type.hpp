@@ -1,34 +1,57 @@
 #pragma once
 
+#include <utils/casting.hpp>
+
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <fmt/ranges.h>
 
 namespace types {
 
+// Concrete class of a Type, see utils::isa
+enum class TypeKind : uint8_t {
+  Primitive,
+  Pointer,
+  Function,
+};
+
 class Type {
  public:
   virtual ~Type() = default;
 
   virtual std::string Format() const = 0;
-  virtual bool Equals(types::Type* other) const = 0;
+
+  // Types are interned by TypeContext, equal types are one object
+  bool Equals(const types::Type* other) const {
+    return this == other;
+  }
+
+  TypeKind GetKind() const {
+    return kind_;
+  }
+
+ protected:
+  explicit Type(TypeKind kind) : kind_(kind) {
+  }
+
+ private:
+  TypeKind kind_;
 };
 
 class PointerType: public Type {
  public:
+  static constexpr TypeKind kKind = TypeKind::Pointer;
+
   explicit PointerType(types::Type* underlying_type) :
-        underlying_type_(underlying_type) {}
+        Type(kKind), underlying_type_(underlying_type) {}
 
   std::string Format() const override {
     return fmt::format("*{}", underlying_type_->Format());
   }
 
-  bool Equals(types::Type* other) const override {
-    if (auto other_prim = dynamic_cast<PointerType*>(other)) {
-      return other_prim->underlying_type_->Equals(underlying_type_);
-    }
-
-    return false;
+  types::Type* GetUnderlyingType() const {
+    return underlying_type_;
   }
 
  private:
@@ -37,8 +60,10 @@ class PointerType: public Type {
 
 class FunctionType: public Type {
  public:
+  static constexpr TypeKind kKind = TypeKind::Function;
+
   FunctionType(types::Type* return_type, std::vector<types::Type*> arg_types) :
-        return_type_(return_type), arg_types_(std::move(arg_types)) {}
+        Type(kKind), return_type_(return_type), arg_types_(std::move(arg_types)) {}
 
   std::string Format() const override {
     std::vector<std::string> arg_type_strs;
@@ -49,29 +74,6 @@ class FunctionType: public Type {
     return fmt::format("[{}] -> {}", fmt::join(arg_type_strs, ", "), return_type_->Format());
   }
 
-  bool Equals(types::Type* other) const override {
-    auto other_func = dynamic_cast<FunctionType*>(other);
-    if (other_func == nullptr) {
-      return false;
-    }
-
-    if (!return_type_->Equals(other_func->return_type_)) {
-      return false;
-    }
-
-    if (arg_types_.size() != other_func->arg_types_.size()) {
-      return false;
-    }
-
-    for (size_t i = 0; i < arg_types_.size(); i++) {
-      if (!arg_types_[i]->Equals(other_func->arg_types_[i])) {
-        return false;
-      }
-    }
-
-    return true;
-  }
-
   const auto& GetArgTypes() const {
     return arg_types_;
   }
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <types/type.hpp>
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace types {
+
+// Owns the pointer and function types of a compilation. Each distinct
+// type is created once, so equal types are the same object and
+// Type::Equals is a pointer compare. Primitive types are the statics of
+// PrimitiveType. Safe to share between parsing threads
+class TypeContext {
+ public:
+  TypeContext() = default;
+
+  // Types are handed out by pointer, keep the context in place
+  TypeContext(const TypeContext&) = delete;
+  TypeContext& operator=(const TypeContext&) = delete;
+
+  PointerType* GetPointerType(Type* pointee) {
+    std::lock_guard guard(mutex_);
+
+    auto& type = pointers_[pointee];
+    if (type == nullptr) {
+      type = std::make_unique<PointerType>(pointee);
+    }
+    return type.get();
+  }
+
+  FunctionType* GetFunctionType(Type* return_type, std::vector<Type*> arg_types) {
+    // Operands are canonical already, the key compares them by address
+    std::vector<Type*> key{return_type};
+    key.insert(key.end(), arg_types.begin(), arg_types.end());
+
+    std::lock_guard guard(mutex_);
+
+    auto& type = functions_[std::move(key)];
+    if (type == nullptr) {
+      type = std::make_unique<FunctionType>(return_type, std::move(arg_types));
+    }
+    return type.get();
+  }
+
+  // Distinct pointer and function types created so far
+  size_t Size() {
+    std::lock_guard guard(mutex_);
+    return pointers_.size() + functions_.size();
+  }
+
+ private:
+  struct OperandsHash {
+    size_t operator()(const std::vector<Type*>& operands) const {
+      size_t hash = operands.size();
+      for (Type* operand : operands) {
+        hash = hash * 31 + std::hash<Type*>{}(operand);
+      }
+      return hash;
+    }
+  };
+
+ private:
+  std::mutex mutex_;
+  std::unordered_map<Type*, std::unique_ptr<PointerType>> pointers_;
+  // Keyed by the return type followed by the argument types
+  std::unordered_map<std::vector<Type*>, std::unique_ptr<FunctionType>, OperandsHash> functions_;
+};
+
+}  // namespace types
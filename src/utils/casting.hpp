@@ -0,0 +1,44 @@
+#pragma once
+
+#include <fmt/core.h>
+
+#include <type_traits>
+
+namespace utils {
+
+// Checked casts inside a class hierarchy tagged with a kind, so that no
+// RTTI is needed. A concrete class `To` declares `static constexpr kKind`
+// and matches values of exactly that kind. An abstract one declares
+// `static bool classof(const Base*)` instead
+
+template <typename To, typename From>
+bool isa(const From* from) {
+  FMT_ASSERT(from != nullptr, "isa<> on a null pointer\n");
+
+  if constexpr (std::is_base_of_v<To, From>) {
+    return true;
+  } else if constexpr (requires { To::kKind; }) {
+    return from->GetKind() == To::kKind;
+  } else {
+    return To::classof(from);
+  }
+}
+
+// Same constness as `From`
+template <typename To, typename From>
+using CastResult = std::conditional_t<std::is_const_v<From>, const To, To>*;
+
+// `from` must be a `To`
+template <typename To, typename From>
+CastResult<To, From> cast(From* from) {
+  FMT_ASSERT(isa<To>(from), "cast<> to an incompatible type\n");
+  return static_cast<CastResult<To, From>>(from);
+}
+
+// Null if `from` is null or not a `To`, as dynamic_cast would give
+template <typename To, typename From>
+CastResult<To, From> dyn_cast(From* from) {
+  return from != nullptr && isa<To>(from) ? static_cast<CastResult<To, From>>(from) : nullptr;
+}
+
+}  // namespace utils
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace utils {
+
+//////////////////////////////////////////////////////////////////////
+
+// Runs batches of indexed tasks on a fixed number of threads. Workers are
+// started once and parked between batches, so a batch only pays for a
+// wake-up. One batch runs at a time, a batch started from inside a task
+// runs on the calling thread
+class ThreadPool {
+ public:
+  // 0 means one thread per core
+  explicit ThreadPool(size_t threads = 0) : size_(threads) {
+    if (size_ == 0) {
+      size_ = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // The thread calling ParallelFor is the last one
+    for (size_t i = 1; i < size_; i++) {
+      workers_.emplace_back([this]() {
+        WorkerLoop();
+      });
+    }
+  }
+
+  ~ThreadPool() {
+    stop_ = true;
+    generation_++;
+    generation_.notify_all();
+
+    for (auto& worker : workers_) {
+      worker.join();
+    }
+  }
+
+  // Workers refer to the pool
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  size_t Size() const {
+    return size_;
+  }
+
+  // Calls func(i) for every i in [0; count) and returns once all of them
+  // are done. The calling thread takes part in the batch. If some calls
+  // throw, the exception of the lowest index is rethrown, so the outcome
+  // does not depend on the scheduling
+  template <typename Func>
+  void ParallelFor(size_t count, Func func) {
+    std::atomic<size_t> next{0};
+    std::vector<std::exception_ptr> errors(count);
+
+    std::function<void()> run_tasks = [&]() {
+      for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+        try {
+          func(i);
+        } catch (...) {
+          errors[i] = std::current_exception();
+        }
+      }
+    };
+
+    if (workers_.empty() || count <= 1 || in_task_) {
+      run_tasks();
+    } else {
+      RunOnWorkers(run_tasks);
+    }
+
+    for (auto& error : errors) {
+      if (error != nullptr) {
+        std::rethrow_exception(error);
+      }
+    }
+  }
+
+ private:
+  void RunOnWorkers(std::function<void()>& run_tasks) {
+    // Callers on several threads take turns
+    std::lock_guard guard(batch_mutex_);
+
+    // Published by the generation bump, read by every worker before it
+    // reports back, so it stays put until the batch is over
+    batch_ = &run_tasks;
+    busy_ = workers_.size();
+    generation_++;
+    generation_.notify_all();
+
+    in_task_ = true;
+    run_tasks();
+    in_task_ = false;
+
+    for (size_t busy = busy_; busy != 0; busy = busy_) {
+      busy_.wait(busy);
+    }
+  }
+
+  void WorkerLoop() {
+    in_task_ = true;
+
+    size_t seen = 0;
+    while (true) {
+      generation_.wait(seen);
+      seen = generation_;
+      if (stop_) {
+        return;
+      }
+
+      (*batch_)();
+
+      if (--busy_ == 0) {
+        busy_.notify_one();
+      }
+    }
+  }
+
+ private:
+  size_t size_;
+  std::vector<std::thread> workers_;
+
+  std::mutex batch_mutex_;
+  std::function<void()>* batch_ = nullptr;
+  // Workers park on the generation and report back through busy_
+  std::atomic<size_t> generation_{0};
+  std::atomic<size_t> busy_{0};
+  std::atomic<bool> stop_{false};
+
+  // Set on workers, and on a caller while it runs its share of a batch
+  static inline thread_local bool in_task_ = false;
+};
+
+//////////////////////////////////////////////////////////////////////
+
+}  // namespace utils
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace utils {
+
+//////////////////////////////////////////////////////////////////////
+
+// Interleaves signs, so small magnitudes of either sign stay small
+inline uint64_t ZigZagEncode(int64_t value) {
+  return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t ZigZagDecode(uint64_t value) {
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+// LEB128: 7 bits per byte, the high bit is set on all but the last one
+inline void WriteVarint(std::string& out, uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<char>(value | 0x80));
+    value >>= 7;
+  }
+
+  out.push_back(static_cast<char>(value));
+}
+
+inline void WriteSignedVarint(std::string& out, int64_t value) {
+  WriteVarint(out, ZigZagEncode(value));
+}
+
+//////////////////////////////////////////////////////////////////////
+
+// Reads from the front of a buffer. Running out of input or a malformed
+// number clears Ok() and reads zeros from then on
+class VarintReader {
+ public:
+  explicit VarintReader(std::string_view data) : data_(data) {
+  }
+
+  uint64_t ReadVarint() {
+    uint64_t value = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+      if (data_.empty()) {
+        break;
+      }
+
+      auto byte = static_cast<uint8_t>(data_.front());
+      data_.remove_prefix(1);
+      value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+
+      if ((byte & 0x80) == 0) {
+        return value;
+      }
+    }
+
+    ok_ = false;
+    data_ = {};
+    return 0;
+  }
+
+  // Length of a sequence whose items take a byte at least, so a damaged
+  // one can't ask for more than there is left
+  size_t ReadCount() {
+    uint64_t count = ReadVarint();
+    if (count > data_.size()) {
+      ok_ = false;
+      data_ = {};
+      return 0;
+    }
+
+    return static_cast<size_t>(count);
+  }
+
+  int64_t ReadSignedVarint() {
+    return ZigZagDecode(ReadVarint());
+  }
+
+  std::string_view ReadBytes(size_t count) {
+    if (count > data_.size()) {
+      ok_ = false;
+      data_ = {};
+      return {};
+    }
+
+    std::string_view bytes = data_.substr(0, count);
+    data_.remove_prefix(count);
+    return bytes;
+  }
+
+  bool Ok() const {
+    return ok_;
+  }
+
+  bool AtEnd() const {
+    return data_.empty();
+  }
+
+ private:
+  std::string_view data_;
+  bool ok_ = true;
+};
+
+//////////////////////////////////////////////////////////////////////
+
+// 64-bit FNV-1a, stable across platforms and runs
+inline uint64_t HashBytes(std::string_view data) {
+  uint64_t hash = 0xcbf29ce484222325;
+  for (char ch : data) {
+    hash ^= static_cast<uint8_t>(ch);
+    hash *= 0x100000001b3;
+  }
+
+  return hash;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+}  // namespace utils
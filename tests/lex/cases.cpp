@@ -1,9 +1,13 @@
 #include <lex/lexer.hpp>
+#include <lex/token_stream.hpp>
+#include <lex/whitespace.hpp>
+#include <utils/thread_pool.hpp>
 
 // Finally,
 #include <catch2/catch.hpp>
 
 #include <iostream>
+#include <random>
 #include <sstream>
 
 //////////////////////////////////////////////////////////////////////
@@ -143,3 +147,565 @@ TEST_CASE("Lex types", "[lex]") {
 }
 
 ////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Zero-copy source", "[lex]") {
+  std::string_view source = "var abc = \"str\";";
+  lex::Lexer l{source};
+
+  CHECK(l.Matches(lex::TokenType::VAR));
+  CHECK(l.Matches(lex::TokenType::IDENTIFIER));
+  CHECK(l.Matches(lex::TokenType::ASSIGN));
+
+  lex::Token str = l.Peek();
+  CHECK(l.Matches(lex::TokenType::STRING));
+  // Token text must point right into the caller's buffer
+  CHECK(str.GetString(l.GetSources()).data() == source.data() + 10);
+
+  CHECK(l.Matches(lex::TokenType::SEMICOLON));
+  CHECK(l.Matches(lex::TokenType::TOKEN_EOF));
+}
+
+////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Locations after whitespace and comments", "[lex]") {
+  std::string_view source =
+      "  \t# comment\n"
+      "\n"
+      "      \t  a  # another one\n"
+      "                                        b";
+  lex::Lexer l{source};
+
+  lex::Token a = l.Peek();
+  CHECK(a.GetLocation().GetLine(l.GetSources()) == 2);
+  CHECK(a.GetLocation().GetColumn(l.GetSources()) == 9);
+
+  l.Advance();
+  lex::Token b = l.Peek();
+  CHECK(b.GetLocation().GetLine(l.GetSources()) == 3);
+  CHECK(b.GetLocation().GetColumn(l.GetSources()) == 40);
+  CHECK(b.offset == source.size() - 1);
+}
+
+//////////////////////////////////////////////////////////////////////
+
+TEST_CASE("SIMD whitespace scan matches scalar", "[lex]") {
+  std::mt19937 gen(42);
+  const char whitespace[] = {' ', ' ', '\t', '\n'};
+
+  for (int iter = 0; iter < 2000; iter++) {
+    std::string text(gen() % 100, ' ');
+    for (auto& ch : text) {
+      // Mostly whitespace, so runs cross several SIMD blocks
+      ch = gen() % 20 == 0 ? 'x' : whitespace[gen() % 4];
+    }
+
+    size_t expected = lex::ScanWhitespaceScalar(text);
+    auto check = [&](size_t length) {
+      CHECK(length == expected);
+    };
+
+    check(lex::ScanWhitespace(text));
+#if defined(__x86_64__)
+    check(lex::ScanWhitespaceSse2(text));
+    if (lex::CpuHasAvx2()) {
+      check(lex::ScanWhitespaceAvx2(text));
+    }
+#endif
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+
+namespace {
+
+std::vector<lex::Token> LexAll(std::string_view source, lex::LexerMode mode) {
+  lex::Lexer l{source, mode};
+  std::vector<lex::Token> tokens;
+  do {
+    tokens.push_back(l.Peek());
+    l.Advance();
+  } while (tokens.back().type != lex::TokenType::TOKEN_EOF);
+
+  return tokens;
+}
+
+void CheckSameTokens(std::string_view source) {
+  auto expected = LexAll(source, lex::LexerMode::Branching);
+  auto actual = LexAll(source, lex::LexerMode::TableDriven);
+
+  REQUIRE(actual.size() == expected.size());
+  for (size_t i = 0; i < expected.size(); i++) {
+    CHECK(actual[i].type == expected[i].type);
+    CHECK(actual[i].offset == expected[i].offset);
+    CHECK(actual[i].payload == expected[i].payload);
+  }
+}
+
+}  // namespace
+
+TEST_CASE("Table-driven lexer matches branching lexer", "[lex]") {
+  CheckSameTokens(
+      "# Complete Lettuce program\n"
+      "\n"
+      "of [Int, Int] -> Int fun main(argc, argv) = {\n"
+      "    return magic_calc(global_var, 12 + 8 / 6, if 1 + 1 == 2 then 13 else 14);\n"
+      "};\n"
+      "of *String var s = \"multi\n  line\";\n"
+      "of Bool var b = !(a != b) < c > -d;\n"
+      "of Unit var u = {x-y_z1; yield 0; for true false};");
+
+  std::mt19937 gen(7);
+  const char* fragments[] = {
+      "+", "-", "->", "*", "/", "=", "==", "!=", "!", "<", ">", "(", ")",
+      "{", "}", "[", "]", ",", ":", ";", "if", "then", "else", "var",
+      "fun", "of", "Int", "ident", "a_b-c", "x1", "42", "007", "\"s t r\"",
+      " ", "\t", "\n", "# comment\n"};
+
+  for (int iter = 0; iter < 200; iter++) {
+    std::string source;
+    for (int i = 0; i < 50; i++) {
+      source += fragments[gen() % std::size(fragments)];
+      source += gen() % 2 == 0 ? " " : "";
+    }
+
+    CheckSameTokens(source);
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Keyword lookalikes", "[lex]") {
+  std::stringstream source("iff thenx Integer Unit_ fo of");
+  lex::Lexer l{source};
+
+  CHECK(l.Matches(lex::TokenType::IDENTIFIER));
+  CHECK(l.Matches(lex::TokenType::IDENTIFIER));
+  CHECK(l.Matches(lex::TokenType::IDENTIFIER));
+  CHECK(l.Matches(lex::TokenType::IDENTIFIER));
+  CHECK(l.Matches(lex::TokenType::IDENTIFIER));
+  CHECK(l.Matches(lex::TokenType::OF));
+}
+
+////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Identifier interning", "[lex]") {
+  lex::IdentTable idents;
+  lex::SourceTable sources{idents};
+  lex::SymbolId foo_id = 0;
+  lex::Token foo;
+
+  {
+    std::string source = "foo bar foo";
+    lex::Lexer l{source, sources};
+
+    lex::Token first = l.Peek();
+    l.Advance();
+    lex::Token second = l.Peek();
+    l.Advance();
+    lex::Token third = l.Peek();
+
+    CHECK(first.GetSymbolId() == third.GetSymbolId());
+    CHECK(first.GetSymbolId() != second.GetSymbolId());
+    foo_id = first.GetSymbolId();
+    foo = first;
+  }
+
+  // Both the source and the lexer are gone by now
+  CHECK(idents.Size() == 2);
+  CHECK(idents.GetName(foo_id) == "foo");
+  CHECK(foo.GetIdentifier(sources) == "foo");
+}
+
+////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Token names outlive the source file", "[lex]") {
+  lex::IdentTable idents;
+  lex::SourceTable sources{idents};
+  lex::Token name;
+
+  {
+    std::string source = "of Int var name = 1;";
+    lex::SourceFile file{source, sources};
+    lex::Lexer l{file, 0, idents};
+    while (l.Peek().type != lex::TokenType::IDENTIFIER) {
+      l.Advance();
+    }
+
+    name = l.Peek();
+    CHECK(name.GetLocation().Format(sources) == "line 1, column 12");
+  }
+
+  CHECK(name.GetIdentifier(sources) == "name");
+  CHECK(sources.Find(name.source_id) == nullptr);
+  CHECK(name.GetLocation().Format(sources) == "offset 11");
+
+  // The slot is reused under a new id, a stale token can't decode another file
+  std::string other_source = "other";
+  lex::SourceFile other{other_source, sources};
+  CHECK(other.GetId() != name.source_id);
+  CHECK(sources.Find(name.source_id) == nullptr);
+  CHECK(sources.Find(other.GetId()) == &other);
+  CHECK(name.GetLocation().GetLine(sources) == 0);
+}
+
+////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Short-lived files reuse source ids", "[lex]") {
+  lex::IdentTable idents;
+  lex::SourceTable sources{idents};
+  std::string source = "of Int var x = 1;";
+
+  std::vector<lex::SourceId> ids;
+  for (size_t i = 0; i < 100000; i++) {
+    lex::Lexer l{source, sources};
+    if (i < 3) {
+      ids.push_back(l.Peek().source_id);
+    }
+    while (l.Peek().type != lex::TokenType::TOKEN_EOF) {
+      l.Advance();
+    }
+  }
+
+  // One slot serves all of them, told apart by the generation
+  CHECK(ids[0] != ids[1]);
+  CHECK(ids[1] != ids[2]);
+  CHECK((ids[0] & 0xffff) == (ids[2] & 0xffff));
+  CHECK(idents.Size() == 1);
+
+  // Files alive at once get slots of their own
+  lex::SourceFile first{source, sources};
+  lex::SourceFile second{source, sources};
+  CHECK((first.GetId() & 0xffff) != (second.GetId() & 0xffff));
+}
+
+////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Token stream", "[lex]") {
+  std::string_view source =
+      "of Int var a = 1;\n"
+      "\n"
+      "  of [Int] -> Int fun f(x) = \"two\n lines\" + x;";
+
+  lex::Lexer streaming{source};
+  lex::Lexer prelexing{source};
+  lex::TokenStream stream{prelexing};
+
+  // Arbitrary lookahead without moving the cursor
+  CHECK(stream.PeekType(2) == lex::TokenType::VAR);
+  CHECK(stream.PeekType(1000) == lex::TokenType::TOKEN_EOF);
+
+  for (size_t i = 0; i < stream.Size(); i++) {
+    lex::Token expected = streaming.Peek();
+    lex::Token actual = stream.Peek();
+
+    CHECK(actual.type == expected.type);
+    CHECK(actual.GetLocation().GetLine(stream.GetSources()) ==
+          expected.GetLocation().GetLine(streaming.GetSources()));
+    CHECK(actual.GetLocation().GetColumn(stream.GetSources()) ==
+          expected.GetLocation().GetColumn(streaming.GetSources()));
+    CHECK(actual.offset == expected.offset);
+    CHECK(actual.payload == expected.payload);
+
+    streaming.Advance();
+    stream.Advance();
+  }
+
+  CHECK(stream.Matches(lex::TokenType::TOKEN_EOF));
+}
+
+////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Compact tokens", "[lex]") {
+  STATIC_REQUIRE(sizeof(lex::Token) <= 16);
+
+  std::string_view source =
+      "of Int var x = 42;\n"
+      "x = \"a\nb\"; y";
+  lex::Lexer l{source};
+
+  lex::Token number = l.Peek();
+  while (number.type != lex::TokenType::NUMBER) {
+    l.Advance();
+    number = l.Peek();
+  }
+  CHECK(number.GetNumber() == 42);
+  CHECK(number.Format(l.GetSources()) == "42");
+
+  l.Advance();
+  l.Advance();
+  lex::Token x = l.Peek();
+  CHECK(x.GetIdentifier(l.GetSources()) == "x");
+  CHECK(x.GetLocation().GetLine(l.GetSources()) == 1);
+  CHECK(x.GetLocation().GetColumn(l.GetSources()) == 0);
+
+  l.Advance();
+  l.Advance();
+  lex::Token str = l.Peek();
+  CHECK(str.type == lex::TokenType::STRING);
+  CHECK(str.GetString(l.GetSources()) == "\"a\nb");
+
+  l.Advance();
+  l.Advance();
+  // Line of a token after a multi-line string
+  lex::Token y = l.Peek();
+  CHECK(y.GetLocation().GetLine(l.GetSources()) == 2);
+  CHECK(y.GetLocation().GetColumn(l.GetSources()) == 4);
+}
+
+////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Parallel lexing matches serial lexing", "[lex]") {
+  std::mt19937 gen(13);
+  const char* lines[] = {
+      "of Int var a = 1 + 2;\n",
+      "of [Int] -> Int fun f(x) = { yield x * 42; };\n",
+      "# a comment with \" in it\n",
+      "\n",
+      "    of Bool var flag = !(a != b);\n",
+  };
+
+  // Long multi-line strings make some chunks start inside a literal,
+  // where the text looks like comments, code and garbage
+  std::string literal = "of *String var s = \"";
+  for (int i = 0; i < 2000; i++) {
+    literal += i % 3 == 0 ? "# not a comment\n" : "of Int var @ = 7;\n";
+  }
+  literal += "\";\n";
+
+  std::string source;
+  while (source.size() < 1024 * 1024) {
+    if (gen() % 200 == 0) {
+      source += literal;
+    } else {
+      source += lines[gen() % std::size(lines)];
+    }
+  }
+
+  lex::IdentTable serial_idents;
+  lex::SourceTable serial_sources{serial_idents};
+  lex::Lexer serial{source, serial_sources};
+  lex::TokenStream expected{serial};
+
+  lex::IdentTable idents;
+  lex::SourceTable sources{idents};
+  lex::SourceFile file{source, sources};
+  utils::ThreadPool pool{4};
+  lex::TokenStream actual{file, pool};
+
+  REQUIRE(actual.Size() == expected.Size());
+  for (size_t i = 0; i < expected.Size(); i++) {
+    REQUIRE(actual.GetType(i) == expected.GetType(i));
+    REQUIRE(actual.GetLocation(i).abs_pos == expected.GetLocation(i).abs_pos);
+    REQUIRE(actual.GetToken(i).payload == expected.GetToken(i).payload);
+  }
+
+  CHECK(idents.Size() == serial_idents.Size());
+  CHECK(actual.GetLocation(actual.Size() / 2).GetLine(sources) ==
+        expected.GetLocation(expected.Size() / 2).GetLine(serial_sources));
+}
+
+////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Thread pool", "[lex]") {
+  utils::ThreadPool pool{4};
+
+  // The same workers serve batch after batch
+  std::atomic<size_t> sum{0};
+  for (size_t batch = 0; batch < 200; batch++) {
+    pool.ParallelFor(100, [&](size_t i) {
+      sum += i;
+    });
+  }
+  CHECK(sum == 200 * (99 * 100 / 2));
+
+  // A batch started from a task runs on that thread instead of waiting
+  // for the busy workers
+  std::vector<size_t> inner_sums(8);
+  pool.ParallelFor(inner_sums.size(), [&](size_t i) {
+    pool.ParallelFor(10, [&](size_t j) {
+      inner_sums[i] += j;
+    });
+  });
+  CHECK(inner_sums == std::vector<size_t>(8, 45));
+
+  // The error of the lowest index wins
+  auto throwing = [](size_t i) {
+    if (i % 7 == 3) {
+      throw std::runtime_error(std::to_string(i));
+    }
+  };
+  CHECK_THROWS_WITH(pool.ParallelFor(100, throwing), "3");
+}
+
+////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Incremental re-lexing", "[lex]") {
+  lex::IdentTable idents;
+  lex::SourceTable sources{idents};
+
+  std::string text =
+      "of Int var abc = 12;\n"
+      "# comment \"not a string\"\n"
+      "of *String var s = \"two\n lines\";\n"
+      "of [Int] -> Int fun f(x) = x + 1;\n";
+  auto file = std::make_unique<lex::SourceFile>(text, sources);
+  lex::Lexer lexer{*file, 0, idents};
+  lex::TokenStream stream{lexer};
+
+  // Extending an identifier touches a single token
+  {
+    lex::TextEdit edit{14, 0, "d"};
+    std::string edited = text;
+    edited.insert(edit.offset, edit.inserted);
+    auto edited_file = std::make_unique<lex::SourceFile>(edited, sources);
+
+    lex::TokenStream copy = stream;
+    CHECK(copy.ApplyEdit(*edited_file, edit) == 1);
+    CHECK(copy.GetToken(3).GetIdentifier(sources) == "abcd");
+  }
+
+  // A quote just typed opens a string up to the end of the file
+  {
+    std::string quoted = "of Int var x = 1;\n";
+    auto quoted_file = std::make_unique<lex::SourceFile>(quoted, sources);
+    lex::Lexer quoted_lexer{*quoted_file, 0, idents};
+    lex::TokenStream quoted_stream{quoted_lexer};
+
+    lex::TextEdit open{3, 0, "\""};
+    quoted.insert(open.offset, open.inserted);
+    auto opened_file = std::make_unique<lex::SourceFile>(quoted, sources);
+    quoted_stream.ApplyEdit(*opened_file, open);
+
+    REQUIRE(quoted_stream.Size() == 3);
+    CHECK(quoted_stream.GetType(0) == lex::TokenType::OF);
+    CHECK(quoted_stream.GetType(1) == lex::TokenType::DUMMY);
+    CHECK(quoted_stream.GetLocation(1).abs_pos == 3);
+    CHECK(quoted_stream.GetType(2) == lex::TokenType::TOKEN_EOF);
+    CHECK(quoted_stream.GetLocation(2).abs_pos == quoted.size());
+
+    // Closing it brings the rest of the tokens back
+    lex::TextEdit close{7, 0, "\""};
+    quoted.insert(close.offset, close.inserted);
+    auto closed_file = std::make_unique<lex::SourceFile>(quoted, sources);
+    quoted_stream.ApplyEdit(*closed_file, close);
+
+    lex::Lexer full{*closed_file, 0, idents};
+    lex::TokenStream expected{full};
+    REQUIRE(quoted_stream.Size() == expected.Size());
+    CHECK(quoted_stream.GetType(1) == lex::TokenType::STRING);
+    for (size_t i = 0; i < expected.Size(); i++) {
+      REQUIRE(quoted_stream.GetType(i) == expected.GetType(i));
+      REQUIRE(quoted_stream.GetLocation(i).abs_pos == expected.GetLocation(i).abs_pos);
+    }
+  }
+
+  std::mt19937 gen(5);
+  const char* fragments[] = {"a", "1", " ", "\n", "#", "\"", "\"s\"",
+                             "+", "-", ">", "=", "!", "(", "of", "Int"};
+
+  for (int iter = 0; iter < 500; iter++) {
+    lex::TextEdit edit;
+    edit.offset = gen() % (text.size() + 1);
+    edit.removed = std::min<size_t>(gen() % 4, text.size() - edit.offset);
+    edit.inserted = fragments[gen() % std::size(fragments)];
+
+    std::string edited = text;
+    edited.replace(edit.offset, edit.removed, edit.inserted);
+    auto edited_file = std::make_unique<lex::SourceFile>(edited, sources);
+
+    stream.ApplyEdit(*edited_file, edit);
+
+    // Malformed edits are expected to give the DUMMY tokens of a full lex
+    lex::Lexer full{*edited_file, 0, idents, /*speculative=*/true};
+    lex::TokenStream expected{full};
+
+    REQUIRE(stream.Size() == expected.Size());
+    for (size_t i = 0; i < expected.Size(); i++) {
+      REQUIRE(stream.GetType(i) == expected.GetType(i));
+      REQUIRE(stream.GetLocation(i).abs_pos == expected.GetLocation(i).abs_pos);
+      REQUIRE(stream.GetToken(i).payload == expected.GetToken(i).payload);
+    }
+
+    text = std::move(edited);
+    file = std::move(edited_file);
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Streaming scanner", "[lex]") {
+  std::string source =
+      "# Complete Lettuce program\n"
+      "of [Int, Int] -> Int fun main(argc, argv) = {\n"
+      "    return magic_calc(global_var, 12 + 8 / 6);\n"
+      "};\n"
+      "of *String var s = \"multi\n  line # not a comment\";\n"
+      "of *String var t = \"multi\n  line # not a comment\";\n"
+      "of Bool var b = !(a != b) < c > -d; # trailing";
+
+  for (size_t buffer_size : {1, 2, 7, 64, 4096}) {
+    for (auto mode : {lex::LexerMode::TableDriven, lex::LexerMode::Branching}) {
+      std::stringstream stream(source);
+      lex::Lexer streaming{stream, mode, buffer_size};
+      lex::Lexer whole{std::string_view{source}, mode};
+
+      while (true) {
+        lex::Token expected = whole.Peek();
+        lex::Token actual = streaming.Peek();
+
+        REQUIRE(actual.type == expected.type);
+        CHECK(actual.offset == expected.offset);
+        CHECK(actual.GetLocation().GetLine(streaming.GetSources()) ==
+              expected.GetLocation().GetLine(whole.GetSources()));
+        CHECK(actual.GetLocation().GetColumn(streaming.GetSources()) ==
+              expected.GetLocation().GetColumn(whole.GetSources()));
+        // Streamed string literals carry an id instead of the length
+        if (expected.type == lex::TokenType::STRING) {
+          CHECK(actual.GetString(streaming.GetSources()) ==
+                expected.GetString(whole.GetSources()));
+        } else {
+          CHECK(actual.payload == expected.payload);
+        }
+
+        if (expected.type == lex::TokenType::TOKEN_EOF) {
+          break;
+        }
+
+        whole.Advance();
+        streaming.Advance();
+      }
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Streaming scanner drops skipped trivia", "[lex]") {
+  constexpr size_t kBufferSize = 4096;
+
+  std::string source;
+  for (int i = 0; i < 20000; i++) {
+    source += "# a comment line which is skipped as a whole\n\n      \n";
+  }
+  source += "of";
+
+  std::stringstream stream(source);
+  lex::IdentTable idents;
+  lex::SourceTable sources(idents);
+  lex::SourceFile sink(sources);
+  lex::Scanner scanner(stream, sink, kBufferSize);
+
+  size_t peak = 0;
+  scanner.SkipWhitespace();
+  while (scanner.CurrentSymbol() == '#') {
+    scanner.MoveNextLine();
+    scanner.SkipWhitespace();
+    peak = std::max(peak, scanner.GetBufferSize());
+  }
+
+  // The window holds a refill or two, however long the run is
+  CHECK(scanner.GetRest() == "of");
+  CHECK(peak <= 2 * kBufferSize);
+}
@@ -2,6 +2,8 @@
 #include <parse/parser.hpp>
 #include <parse/parse_error.hpp>
 #include <ast/visitors/serialize_visitor.hpp>
+#include <ast/visitors/flat_tree_builder.hpp>
+#include <ast/binary_ast.hpp>
 
 // Finally,
 #include <catch2/catch.hpp>
@@ -32,10 +34,12 @@ TEST_CASE("Parser: just works", "[parse]") {
       "\t\tLiteral expression: 7\n";
 
   lex::Lexer lexer(expr);
-  parse::Parser parser(lexer);
+  types::TypeContext type_keeper;
+  ast::Arena arena;
+  parse::Parser parser(lexer, type_keeper, arena);
   ast::Statement* stmt = parser.ParseStatement();
 
-  ast::SerializeVisitor serializer;
+  ast::SerializeVisitor serializer(lexer.GetSources());
   stmt->Accept(&serializer);
 
   CHECK(serializer.GetSerializedString() == expected_output);
@@ -43,8 +47,8 @@ TEST_CASE("Parser: just works", "[parse]") {
 
 TEST_CASE("Parser: complex test", "[parse]") {
   std::stringstream program;
-  program << "fun main(argc, argv) = {"
-             "    var hello = 6 * (12 + 1);"
+  program << "of [Int, Int] -> Int fun main(argc, argv) = {"
+             "    of Int var hello = 6 * (12 + 1);"
              "    if hello == 12 then {"
              "        abobus;"
              "    } else {"
@@ -73,7 +77,7 @@ TEST_CASE("Parser: complex test", "[parse]") {
       "\t\tExpression statement\n"
       "\t\t\tIf\n"
       "\t\t\tCondition:\n"
-      "\t\t\t\tBinary expression: ==\n"
+      "\t\t\t\tComparison: ==\n"
       "\t\t\t\tLHS:\n"
       "\t\t\t\t\tLiteral expression: hello\n"
       "\t\t\t\tRHS\n"
@@ -92,17 +96,19 @@ TEST_CASE("Parser: complex test", "[parse]") {
       "\t\tExpression statement\n"
       "\t\t\tReturn\n"
       "\t\t\tValue (expression):\n"
-      "\t\t\t\tBinary expression: !=\n"
+      "\t\t\t\tComparison: !=\n"
       "\t\t\t\tLHS:\n"
       "\t\t\t\t\tLiteral expression: bebra\n"
       "\t\t\t\tRHS\n"
       "\t\t\t\t\tLiteral expression: 7\n";
 
   lex::Lexer lexer(program);
-  parse::Parser parser(lexer);
+  types::TypeContext type_keeper;
+  ast::Arena arena;
+  parse::Parser parser(lexer, type_keeper, arena);
   ast::Declaration* decl = parser.ParseDeclaration();
 
-  ast::SerializeVisitor serializer;
+  ast::SerializeVisitor serializer(lexer.GetSources());
   decl->Accept(&serializer);
 
   CHECK(serializer.GetSerializedString() == expected_output);
@@ -113,14 +119,18 @@ TEST_CASE("Parser: basic errors", "[parse]") {
   expr << "{ (1 + 2) * 3 / 7 if kek then true; };";
 
   lex::Lexer lexer(expr);
-  parse::Parser parser(lexer);
+  types::TypeContext type_keeper;
+  ast::Arena arena;
+  parse::Parser parser(lexer, type_keeper, arena);
   CHECK_THROWS_AS(parser.ParseStatement(), parse::errors::ParseCompoundError);
 
   std::stringstream expr2;
   expr2 << "if (1 + 2) * 3 / 7";
 
   lex::Lexer lexer2(expr);
-  parse::Parser parser2(lexer2);
+  types::TypeContext type_keeper2;
+  ast::Arena arena2;
+  parse::Parser parser2(lexer2, type_keeper2, arena2);
   CHECK_THROWS_AS(parser.ParseExpression(), parse::errors::ParseError);
 }
 
@@ -128,11 +138,11 @@ TEST_CASE("Parser: whole program", "[parse]") {
   std::stringstream prg;
   prg << "# Complete Lettuce program\n"
          "\n"
-         "var global_var = if 12 == 11 + 1 then 14 else 15 + 81;\n"
+         "of Int var global_var = if 12 == 11 + 1 then 14 else 15 + 81;\n"
          "\n"
-         "fun magic_calc(a, b, c) = { if (global_var == 14) then return a * b + c; a + b * c; };\n"
+         "of [Int, Int, Int] -> Int fun magic_calc(a, b, c) = { if (global_var == 14) then return a * b + c; a + b * c; };\n"
          "\n"
-         "fun main(argc, argv) = {\n"
+         "of [Int, Int] -> Int fun main(argc, argv) = {\n"
          "    return magic_calc(global_var, 12 + 8 / 6, if 1 + 1 == 2 then 13 else 14);\n"
          "};\n";
 
@@ -142,7 +152,7 @@ TEST_CASE("Parser: whole program", "[parse]") {
       "\tInitializer:\n"
       "\t\tIf\n"
       "\t\tCondition:\n"
-      "\t\t\tBinary expression: ==\n"
+      "\t\t\tComparison: ==\n"
       "\t\t\tLHS:\n"
       "\t\t\t\tLiteral expression: 12\n"
       "\t\t\tRHS\n"
@@ -168,7 +178,7 @@ TEST_CASE("Parser: whole program", "[parse]") {
       "\t\t\tExpression statement\n"
       "\t\t\t\tIf\n"
       "\t\t\t\tCondition:\n"
-      "\t\t\t\t\tBinary expression: ==\n"
+      "\t\t\t\t\tComparison: ==\n"
       "\t\t\t\t\tLHS:\n"
       "\t\t\t\t\t\tLiteral expression: global_var\n"
       "\t\t\t\t\tRHS\n"
@@ -223,7 +233,7 @@ TEST_CASE("Parser: whole program", "[parse]") {
       "\t\t\t\t\tArg 2:\n"
       "\t\t\t\t\t\tIf\n"
       "\t\t\t\t\t\tCondition:\n"
-      "\t\t\t\t\t\t\tBinary expression: ==\n"
+      "\t\t\t\t\t\t\tComparison: ==\n"
       "\t\t\t\t\t\t\tLHS:\n"
       "\t\t\t\t\t\t\t\tBinary expression: +\n"
       "\t\t\t\t\t\t\t\tLHS:\n"
@@ -238,10 +248,12 @@ TEST_CASE("Parser: whole program", "[parse]") {
       "\t\t\t\t\t\t\tLiteral expression: 14\n";
 
   lex::Lexer lexer(prg);
-  parse::Parser parser(lexer);
+  types::TypeContext type_keeper;
+  ast::Arena arena;
+  parse::Parser parser(lexer, type_keeper, arena);
   ast::Program* stmt = parser.ParseProgram();
 
-  ast::SerializeVisitor serializer;
+  ast::SerializeVisitor serializer(lexer.GetSources());
   stmt->Accept(&serializer);
   CHECK(serializer.GetSerializedString() == expected_output);
 }
@@ -279,10 +291,593 @@ TEST_CASE("Parser: complex function call", "[parse]") {
       "\t\tLiteral expression: hh\n";
 
   lex::Lexer lexer(prg);
-  parse::Parser parser(lexer);
+  types::TypeContext type_keeper;
+  ast::Arena arena;
+  parse::Parser parser(lexer, type_keeper, arena);
   ast::Expression* expr = parser.ParseExpression();
 
-  ast::SerializeVisitor serializer;
+  ast::SerializeVisitor serializer(lexer.GetSources());
   expr->Accept(&serializer);
   CHECK(serializer.GetSerializedString() == expected_output);
-}
\ No newline at end of file
+}
+
+////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Parser: token stream mode", "[parse]") {
+  std::string_view prg =
+      "of Int var global_var = if 12 == 11 + 1 then 14 else 15 + 81;\n"
+      "of [Int, Int] -> Int fun main(argc, argv) = {\n"
+      "    return argc(global_var, 12 + 8 / 6);\n"
+      "};\n";
+
+  types::TypeContext type_keeper;
+  ast::Arena arena;
+
+  lex::Lexer lexer(prg);
+  parse::Parser streaming_parser(lexer, type_keeper, arena);
+  ast::SerializeVisitor expected(lexer.GetSources());
+  streaming_parser.ParseProgram()->Accept(&expected);
+
+  lex::Lexer prelexer(prg);
+  lex::TokenStream tokens(prelexer);
+  parse::Parser stream_parser(tokens, type_keeper, arena);
+  ast::SerializeVisitor actual(tokens.GetSources());
+  stream_parser.ParseProgram()->Accept(&actual);
+
+  CHECK(actual.GetSerializedString() == expected.GetSerializedString());
+}
+
+////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Parser: nodes live in the arena", "[parse]") {
+  std::string_view prg =
+      "of [Int, Int] -> Int fun main(argc, argv) = {\n"
+      "    return argc(argv, 12 + 8 / 6);\n"
+      "};\n";
+
+  lex::Lexer lexer(prg);
+  types::TypeContext type_keeper;
+  ast::Arena arena{/*slab_size=*/128};
+  parse::Parser parser(lexer, type_keeper, arena);
+  ast::Program* program = parser.ParseProgram();
+
+  REQUIRE(program->decls_.size() == 1);
+  auto* fun = utils::dyn_cast<ast::FunDeclStatement>(program->decls_[0]);
+  REQUIRE(fun != nullptr);
+  CHECK(fun->params_.size() == 2);
+
+  // Small slabs force several of them
+  CHECK(arena.GetSlabCount() > 1);
+  CHECK(arena.GetBytesUsed() > sizeof(ast::Program) + sizeof(ast::FunDeclStatement));
+
+  // Oversized allocations get a slab of their own
+  std::vector<int> big(1000, 7);
+  std::span<int> copy = arena.NewArray(big);
+  CHECK(copy.size() == big.size());
+  CHECK(copy.back() == 7);
+}
+
+////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Parser: precedence and associativity", "[parse]") {
+  lex::Lexer lexer("1 - 2 - 3 == 4 < 5 * -6 / 7;");
+  types::TypeContext type_keeper;
+  ast::Arena arena;
+  parse::Parser parser(lexer, type_keeper, arena);
+
+  auto* stmt = utils::dyn_cast<ast::ExprStatement>(parser.ParseStatement());
+  REQUIRE(stmt != nullptr);
+
+  auto* equals = utils::dyn_cast<ast::ComparisonExpression>(stmt->expr_);
+  REQUIRE(equals != nullptr);
+  CHECK(equals->operation_.type == lex::TokenType::EQUALS);
+
+  // (1 - 2) - 3
+  auto* minus = utils::dyn_cast<ast::BinaryExpression>(equals->lhs_);
+  REQUIRE(minus != nullptr);
+  CHECK(utils::isa<ast::BinaryExpression>(minus->lhs_));
+  CHECK(utils::isa<ast::LiteralExpression>(minus->rhs_));
+
+  // 4 < ((5 * -6) / 7)
+  auto* less = utils::dyn_cast<ast::ComparisonExpression>(equals->rhs_);
+  REQUIRE(less != nullptr);
+  CHECK(less->operation_.type == lex::TokenType::LT);
+
+  auto* div = utils::dyn_cast<ast::BinaryExpression>(less->rhs_);
+  REQUIRE(div != nullptr);
+  CHECK(div->operation_.type == lex::TokenType::DIV);
+
+  auto* star = utils::dyn_cast<ast::BinaryExpression>(div->lhs_);
+  REQUIRE(star != nullptr);
+  CHECK(utils::isa<ast::UnaryExpression>(star->rhs_));
+}
+
+////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Parser: error recovery", "[parse]") {
+  lex::Lexer lexer(
+      "of Int var x = 1 +;\n"
+      "of Int var y = 2;\n"
+      "of [] -> Int fun f() = {\n"
+      "    y = (3;\n"
+      "    return y;\n"
+      "};\n"
+      "of Int var z = {\n");
+  types::TypeContext type_keeper;
+  ast::Arena arena;
+  parse::Parser parser(lexer, type_keeper, arena, parse::ErrorMode::Recover);
+
+  ast::Program* program = nullptr;
+  REQUIRE_NOTHROW(program = parser.ParseProgram());
+  CHECK(parser.GetErrors().size() == 3);
+
+  REQUIRE(program->decls_.size() == 4);
+  CHECK(utils::isa<ast::ErrorStatement>(program->decls_[0]));
+  CHECK(utils::isa<ast::VarDeclStatement>(program->decls_[1]));
+  CHECK(utils::isa<ast::ErrorStatement>(program->decls_[3]));
+
+  // The broken statement is replaced, the rest of the block survives
+  auto* fun = utils::dyn_cast<ast::FunDeclStatement>(program->decls_[2]);
+  REQUIRE(fun != nullptr);
+  auto* block = utils::dyn_cast<ast::BlockExpression>(fun->body_);
+  REQUIRE(block != nullptr);
+  REQUIRE(block->statements_.size() == 2);
+  CHECK(utils::isa<ast::ErrorStatement>(block->statements_[0]));
+  CHECK(utils::isa<ast::ExprStatement>(block->statements_[1]));
+
+  ast::SerializeVisitor serializer(lexer.GetSources());
+  program->decls_[0]->Accept(&serializer);
+  CHECK(serializer.GetSerializedString() == "Error statement\n");
+}
+
+////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Parser: parallel program parsing", "[parse]") {
+  std::string prg;
+  for (size_t i = 0; i < 3000; i++) {
+    prg += fmt::format(
+        "of [Int] -> Int fun f{0}(x) = {{\n"
+        "    of Int var y = x * {0};\n"
+        "    return if y > 10 then f{0}(y - 1) else y;\n"
+        "}};\n", i);
+
+    if (i % 1000 == 500) {
+      // Broken declarations are recovered from the same way
+      prg += "of Int var broken = 1 +;\n";
+    }
+  }
+
+  lex::Lexer lexer(prg);
+  lex::TokenStream tokens(lexer);
+  types::TypeContext type_keeper;
+  ast::Arena arena;
+  utils::ThreadPool pool(4);
+
+  parse::Parser serial(tokens, type_keeper, arena, parse::ErrorMode::Recover);
+  ast::SerializeVisitor expected(lexer.GetSources());
+  serial.ParseProgram()->Accept(&expected);
+
+  parse::Parser parallel(tokens, type_keeper, arena, parse::ErrorMode::Recover);
+  ast::Program* program = parallel.ParseProgram(pool);
+  ast::SerializeVisitor actual(lexer.GetSources());
+  program->Accept(&actual);
+
+  CHECK(program->decls_.size() == 3003);
+  CHECK(actual.GetSerializedString() == expected.GetSerializedString());
+
+  REQUIRE(parallel.GetErrors().size() == 3);
+  for (size_t i = 0; i < 3; i++) {
+    CHECK(parallel.GetErrors()[i].message == serial.GetErrors()[i].message);
+  }
+
+  parse::Parser throwing(tokens, type_keeper, arena);
+  CHECK_THROWS_AS(throwing.ParseProgram(pool), parse::errors::ParseProgramError);
+}
+
+////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Parser: parallel parsing of a broken body", "[parse]") {
+  // Recovery skips to the next ';' inside the body and leaves its block
+  // open, so the rest of the file is not split where the prescan thinks
+  std::string prg;
+  for (size_t i = 0; i < 3000; i++) {
+    if (i == 1000) {
+      prg += "of [] -> Int fun broken() = { 1 + };\n";
+    } else {
+      prg += fmt::format("of [Int] -> Int fun f{0}(x) = {{ of Int var y = x * {0}; y; }};\n", i);
+    }
+  }
+
+  lex::Lexer lexer(prg);
+  lex::TokenStream tokens(lexer);
+  types::TypeContext type_keeper;
+  ast::Arena arena;
+  utils::ThreadPool pool(4);
+
+  parse::Parser serial(tokens, type_keeper, arena, parse::ErrorMode::Recover);
+  ast::Program* expected_program = serial.ParseProgram();
+  ast::SerializeVisitor expected(lexer.GetSources());
+  expected_program->Accept(&expected);
+
+  parse::Parser parallel(tokens, type_keeper, arena, parse::ErrorMode::Recover);
+  ast::Program* program = parallel.ParseProgram(pool);
+  ast::SerializeVisitor actual(lexer.GetSources());
+  program->Accept(&actual);
+
+  CHECK(program->decls_.size() == expected_program->decls_.size());
+  CHECK(actual.GetSerializedString() == expected.GetSerializedString());
+
+  REQUIRE(parallel.GetErrors().size() == serial.GetErrors().size());
+  for (size_t i = 0; i < serial.GetErrors().size(); i++) {
+    CHECK(parallel.GetErrors()[i].message == serial.GetErrors()[i].message);
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Parser: type interning", "[parse]") {
+  std::string prg;
+  for (size_t i = 0; i < 2000; i++) {
+    prg += fmt::format("of [Int, *Int] -> *Int fun f{}(a, b) = {{ b; }};\n", i);
+    prg += fmt::format("of **Int var p{} = q;\n", i);
+  }
+
+  lex::Lexer lexer(prg);
+  lex::TokenStream tokens(lexer);
+  types::TypeContext type_keeper;
+  ast::Arena arena;
+  utils::ThreadPool pool(4);
+
+  // Batches parsed on other threads share the types too
+  parse::Parser parser(tokens, type_keeper, arena);
+  ast::Program* program = parser.ParseProgram(pool);
+  REQUIRE(program->decls_.size() == 4000);
+
+  auto* first = utils::cast<ast::FunDeclStatement>(program->decls_[0]);
+  auto* last = utils::cast<ast::FunDeclStatement>(program->decls_[3998]);
+  CHECK(first->type_ == last->type_);
+  CHECK(first->type_->Equals(last->type_));
+
+  auto* function = utils::cast<types::FunctionType>(first->type_);
+  CHECK(function->GetArgTypes()[1] == function->GetReturnType());
+  CHECK_FALSE(function->GetArgTypes()[0]->Equals(function->GetArgTypes()[1]));
+
+  auto* var = utils::cast<ast::VarDeclStatement>(program->decls_[1]);
+  auto* pointer = utils::cast<types::PointerType>(var->type_);
+  CHECK(pointer->GetUnderlyingType() == function->GetReturnType());
+
+  // *Int, **Int and the function type
+  CHECK(type_keeper.Size() == 3);
+}
+
+////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Parser: lazy function bodies", "[parse]") {
+  std::string_view prg =
+      "of Int var global_var = 7;\n"
+      "of [Int, Int] -> Int fun main(argc, argv) = {\n"
+      "    of [] -> Int fun inner() = { return argc; };\n"
+      "    return argc(global_var, 12 + 8 / 6);\n"
+      "};\n"
+      "of [Int] -> Int fun id(x) = x;\n"
+      "of [] -> Int fun broken() = { 1 + ; };\n";
+
+  types::TypeContext type_keeper;
+  ast::Arena arena;
+
+  lex::Lexer lexer(prg);
+  lex::TokenStream tokens(lexer);
+
+  parse::Parser eager(tokens, type_keeper, arena, parse::ErrorMode::Recover);
+  ast::SerializeVisitor expected(lexer.GetSources());
+  eager.ParseProgram()->Accept(&expected);
+  CHECK(eager.GetErrors().size() == 1);
+
+  parse::Parser lazy(tokens, type_keeper, arena, parse::ErrorMode::Recover);
+  lazy.SetLazyBodies(true);
+  ast::Program* program = lazy.ParseProgram();
+
+  // Signatures only, nothing is wrong yet
+  REQUIRE(program->decls_.size() == 4);
+  CHECK(lazy.GetErrors().empty());
+
+  auto* main = utils::dyn_cast<ast::FunDeclStatement>(program->decls_[1]);
+  REQUIRE(main != nullptr);
+  CHECK(main->type_->GetArgTypes().size() == 2);
+  CHECK_FALSE(main->IsBodyParsed());
+
+  REQUIRE(main->GetBody() != nullptr);
+  CHECK(main->IsBodyParsed());
+
+  ast::SerializeVisitor actual(lexer.GetSources());
+  program->Accept(&actual);
+  CHECK(actual.GetSerializedString() == expected.GetSerializedString());
+  CHECK(lazy.GetErrors().size() == 1);
+}
+
+////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Parser: flat tree round trip", "[parse]") {
+  std::string_view prg =
+      "of Int var global_var = if 12 == 11 + 1 then 14 else 15 + 81;\n"
+      "of [Int, Int] -> Int fun main(argc, argv) = {\n"
+      "    of *Int var ptr = -argc;\n"
+      "    ptr = argc(global_var, 12 + 8 / 6);\n"
+      "    if argc < 1 then { yield 1; };\n"
+      "    return main();\n"
+      "};\n"
+      "of Int var broken = (1;\n";
+
+  types::TypeContext type_keeper;
+  ast::Arena arena;
+
+  lex::Lexer lexer(prg);
+  parse::Parser parser(lexer, type_keeper, arena, parse::ErrorMode::Recover);
+  ast::Program* program = parser.ParseProgram();
+
+  ast::FlatTreeBuilder builder;
+  program->Accept(&builder);
+  ast::FlatTree tree = builder.TakeTree();
+
+  // Pre-order: the program, then its first declaration
+  REQUIRE(tree.Size() > 2);
+  CHECK(tree.GetKind(tree.GetRoot()) == ast::NodeKind::Program);
+  CHECK(tree.GetKind(1) == ast::NodeKind::VarDecl);
+  CHECK(tree.GetToken(1).GetIdentifier(lexer.GetSources()) == "global_var");
+  CHECK(tree.GetList(tree.GetLhs(tree.GetRoot())).size() == 3);
+
+  // A fraction of the class tree
+  CHECK(tree.GetBytesUsed() * 2 < arena.GetBytesUsed());
+
+  ast::Arena rebuilt_arena;
+  ast::Program* rebuilt = tree.ToProgram(rebuilt_arena);
+
+  ast::SerializeVisitor expected(lexer.GetSources());
+  program->Accept(&expected);
+  ast::SerializeVisitor actual(lexer.GetSources());
+  rebuilt->Accept(&actual);
+  CHECK(actual.GetSerializedString() == expected.GetSerializedString());
+}
+
+////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Parser: binary AST", "[parse]") {
+  std::string_view prg =
+      "of Int var global_var = if 12 == 11 + 1 then 14 else 15 + 81;\n"
+      "of [*Int, Bool] -> *Int fun main(argc, argv) = {\n"
+      "    of String var str = \"hello\";\n"
+      "    argc = argc(global_var, 12 + 8 / 6);\n"
+      "    return -argc;\n"
+      "};\n";
+
+  lex::IdentTable idents;
+  lex::SourceTable sources(idents);
+  types::TypeContext type_keeper;
+  ast::Arena arena;
+
+  lex::Lexer lexer(prg, sources);
+  parse::Parser parser(lexer, type_keeper, arena);
+  ast::Program* program = parser.ParseProgram();
+
+  ast::FlatTreeBuilder builder;
+  program->Accept(&builder);
+  std::string data = ast::BinaryAst::Write(builder.TakeTree(), idents);
+
+  // Loaded next to other names, ids are translated
+  lex::IdentTable other_idents;
+  other_idents.Intern("unrelated");
+  lex::SourceTable other_sources(other_idents);
+  lex::SourceFile source(prg, other_sources);
+
+  types::TypeContext other_types;
+  auto tree = ast::BinaryAst::Read(data, source, other_types);
+  REQUIRE(tree.has_value());
+
+  ast::Arena other_arena;
+  ast::Program* loaded = tree->ToProgram(other_arena);
+
+  ast::SerializeVisitor expected(sources);
+  program->Accept(&expected);
+  ast::SerializeVisitor actual(other_sources);
+  loaded->Accept(&actual);
+  CHECK(actual.GetSerializedString() == expected.GetSerializedString());
+
+  auto* fun = utils::dyn_cast<ast::FunDeclStatement>(loaded->decls_[1]);
+  REQUIRE(fun != nullptr);
+  CHECK(fun->type_->Format() == "[*Int, Bool] -> *Int");
+  CHECK(fun->name_.GetIdentifier(other_sources) == "main");
+
+  // Damaged or foreign data is rejected
+  std::string damaged = data;
+  damaged[damaged.size() / 2] ^= 1;
+  CHECK_FALSE(ast::BinaryAst::Read(damaged, source, other_types));
+  CHECK_FALSE(ast::BinaryAst::Read(data.substr(0, data.size() - 1), source, other_types));
+  CHECK_FALSE(ast::BinaryAst::Read("", source, other_types));
+
+  // Damage behind a valid checksum is caught by the structural checks:
+  // whatever Read accepts must rebuild without tripping over anything
+  auto reseal = [](std::string damaged) {
+    damaged.resize(damaged.size() - sizeof(uint64_t));
+    uint64_t checksum = utils::HashBytes(damaged);
+    damaged.append(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+    return damaged;
+  };
+
+  size_t rejected = 0;
+  for (size_t pos = ast::BinaryAst::kMagic.size(); pos + sizeof(uint64_t) < data.size(); pos++) {
+    for (char value : {'\x00', '\x01', '\x7f', '\xff'}) {
+      std::string damaged = data;
+      if (damaged[pos] == value) {
+        continue;
+      }
+      damaged[pos] = value;
+
+      auto damaged_tree = ast::BinaryAst::Read(reseal(damaged), source, other_types);
+      if (!damaged_tree.has_value()) {
+        rejected++;
+        continue;
+      }
+
+      ast::Arena damaged_arena;
+      ast::SerializeVisitor serializer(other_sources);
+      damaged_tree->ToProgram(damaged_arena)->Accept(&serializer);
+    }
+  }
+  CHECK(rejected > 0);
+}
+
+////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Parser: iterative parsing", "[parse]") {
+  std::string_view prg =
+      "of Int var global_var = if 12 == 11 + 1 then 14 else if 1 < 2 then 15 + 81 * 2;\n"
+      "of [*Int, Bool] -> *Int fun main(argc, argv) = {\n"
+      "    of String var str = \"hello\";\n"
+      "    argc = argc(global_var, 12 + 8 / 6)(-(1 - 2 - 3), {});\n"
+      "    of [Int] -> Int fun inner(x) = { yield x; };\n"
+      "    { { 1; }; };\n"
+      "    return -!argc();\n"
+      "};\n";
+
+  auto serialize = [](std::string_view source, bool iterative) {
+    lex::Lexer lexer(source);
+    types::TypeContext type_keeper;
+    ast::Arena arena;
+    parse::Parser parser(lexer, type_keeper, arena);
+    parser.SetIterative(iterative);
+
+    ast::SerializeVisitor serializer(lexer.GetSources());
+    parser.ParseProgram()->Accept(&serializer);
+    return serializer.GetSerializedString();
+  };
+
+  CHECK(serialize(prg, true) == serialize(prg, false));
+
+  // Same recovery from broken input
+  std::string_view broken =
+      "of Int var x = 1 +;\n"
+      "of [] -> Int fun f() = {\n"
+      "    { y = (3; z; };\n"
+      "    return if y then { x + ; } else 1;\n"
+      "};\n"
+      "of Int var z = { {\n";
+
+  auto recover = [](std::string_view source, bool iterative) {
+    lex::Lexer lexer(source);
+    types::TypeContext type_keeper;
+    ast::Arena arena;
+    parse::Parser parser(lexer, type_keeper, arena, parse::ErrorMode::Recover);
+    parser.SetIterative(iterative);
+
+    ast::SerializeVisitor serializer(lexer.GetSources());
+    parser.ParseProgram()->Accept(&serializer);
+
+    std::string result = serializer.GetSerializedString();
+    for (auto& error : parser.GetErrors()) {
+      result += error.message + "\n";
+    }
+    return result;
+  };
+
+  CHECK(recover(broken, true) == recover(broken, false));
+
+  lex::Lexer lexer(broken);
+  types::TypeContext type_keeper;
+  ast::Arena arena;
+  parse::Parser parser(lexer, type_keeper, arena);
+  parser.SetIterative(true);
+  CHECK_THROWS_AS(parser.ParseProgram(), parse::errors::ParseProgramError);
+}
+
+////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Parser: deep nesting", "[parse]") {
+  // Far past what recursion survives on a default stack
+  constexpr size_t kDepth = 100'000;
+
+  std::string prg = "of Int var chain = 0";
+  for (size_t i = 0; i < kDepth; i++) {
+    prg += " + 1";
+  }
+  prg += ";\nof Int var ladder = ";
+  for (size_t i = 0; i < kDepth; i++) {
+    prg += fmt::format("if chain == {} then {} else ", i, i);
+  }
+  prg += "0;\nof Int var nested = ";
+  for (size_t i = 0; i < kDepth; i++) {
+    prg += "{ -(";
+  }
+  prg += "chain";
+  for (size_t i = 0; i < kDepth; i++) {
+    prg += "); }";
+  }
+  prg += ";\n";
+
+  lex::Lexer lexer(prg);
+  types::TypeContext type_keeper;
+  ast::Arena arena;
+  parse::Parser parser(lexer, type_keeper, arena);
+  parser.SetIterative(true);
+
+  ast::Program* program = nullptr;
+  REQUIRE_NOTHROW(program = parser.ParseProgram());
+  REQUIRE(program->decls_.size() == 3);
+
+  // The tree is as deep as the input
+  auto* ladder = utils::dyn_cast<ast::VarDeclStatement>(program->decls_[1]);
+  REQUIRE(ladder != nullptr);
+  size_t depth = 0;
+  for (ast::Expression* expr = ladder->init_expr_; auto* if_expr = utils::dyn_cast<ast::IfExpression>(expr);
+       expr = if_expr->else_branch_) {
+    depth++;
+  }
+  CHECK(depth == kDepth);
+
+  // And walks of it do not recurse either
+  struct DepthVisitor : ast::BaseVisitor {
+    void EnterChild(ast::TreeNode*, size_t) override {
+      max_depth = std::max(max_depth, ++depth);
+    }
+
+    void LeaveChild(ast::TreeNode*, size_t) override {
+      depth--;
+    }
+
+    size_t depth = 0;
+    size_t max_depth = 0;
+  } visitor;
+
+  program->Accept(&visitor);
+  CHECK(visitor.depth == 0);
+  CHECK(visitor.max_depth > 2 * kDepth);
+}
+
+//////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Parser: node kinds", "[parse]") {
+  std::stringstream source("of Int var x = 1; of [Int] -> Int fun f(a) = { x = a; -a; };");
+  lex::Lexer lexer(source);
+  types::TypeContext type_keeper;
+  ast::Arena arena;
+  parse::Parser parser(lexer, type_keeper, arena);
+
+  ast::Program* program = parser.ParseProgram();
+  REQUIRE(program->decls_.size() == 2);
+
+  ast::TreeNode* var = program->decls_[0];
+  CHECK(utils::isa<ast::Declaration>(var));
+  CHECK(utils::isa<ast::Statement>(var));
+  CHECK_FALSE(utils::isa<ast::Expression>(var));
+  CHECK(utils::isa<ast::Expression>(utils::cast<ast::VarDeclStatement>(var)->init_expr_));
+
+  auto* fun = utils::cast<ast::FunDeclStatement>(program->decls_[1]);
+  CHECK(utils::isa<types::FunctionType>(fun->type_));
+  CHECK_FALSE(utils::isa<types::PointerType>(fun->type_));
+
+  auto* block = utils::cast<ast::BlockExpression>(fun->GetBody());
+  REQUIRE(block->statements_.size() == 2);
+  CHECK(utils::isa<ast::Statement>(block->statements_[0]));
+  CHECK_FALSE(utils::isa<ast::Declaration>(block->statements_[0]));
+  CHECK(utils::isa<ast::UnaryExpression>(utils::cast<ast::ExprStatement>(block->statements_[1])->expr_));
+  CHECK_FALSE(utils::isa<ast::LvalueExpression>(utils::cast<ast::ExprStatement>(block->statements_[1])->expr_));
+}
@@ -3,6 +3,9 @@
 #include <parse/parse_error.hpp>
 #include <passes/symbol_table_builder.hpp>
 #include <passes/definition_checker.hpp>
+#include <passes/type_evaluator.hpp>
+#include <passes/parallel_analyzer.hpp>
+#include <ast/visitors/fused_visitor.hpp>
 
 // Finally,
 #include <catch2/catch.hpp>
@@ -17,20 +20,22 @@ TEST_CASE("Symbol table: just works", "[symbol]") {
   std::stringstream program;
   program << "# Complete Lettuce program\n"
              "\n"
-             "var global_var = if 12 == 11 + 1 then 14 else 15 + 81;\n"
+             "of Int var global_var = if 12 == 11 + 1 then 14 else 15 + 81;\n"
              "\n"
-             "fun magic_calc(a, b, c) = {\n"
+             "of [Int, Int, Int] -> Int fun magic_calc(a, b, c) = {\n"
              "    if (global_var == 14) then return a * b + c; a + b * c;\n"
              "};";
 
   lex::Lexer lexer(program);
-  parse::Parser parser(lexer);
+  types::TypeContext type_keeper;
+  ast::Arena arena;
+  parse::Parser parser(lexer, type_keeper, arena);
   ast::Program* prg = parser.ParseProgram();
 
-  ast::SymbolTableBuilder gen;
+  passes::SymbolTableBuilder gen(arena, lexer.GetSources());
   prg->Accept(&gen);
 
-  ast::DefinitionChecker checker;
+  passes::DefinitionChecker checker(lexer.GetSources());
   prg->Accept(&checker);
 }
 
@@ -38,20 +43,22 @@ TEST_CASE("Symbol table: undefined symbol", "[symbol]") {
   std::stringstream program;
   program << "# Complete Lettuce program\n"
              "\n"
-             "var global_var = if 12 == 11 + 1 then 14 else 15 + 81;\n"
+             "of Int var global_var = if 12 == 11 + 1 then 14 else 15 + 81;\n"
              "\n"
-             "fun magic_calc(b, c) = {\n"
+             "of [Int, Int] -> Int fun magic_calc(b, c) = {\n"
              "    if (global_var == 14) then return a * b + c; a + b * c;\n"
              "};";
 
   lex::Lexer lexer(program);
-  parse::Parser parser(lexer);
+  types::TypeContext type_keeper;
+  ast::Arena arena;
+  parse::Parser parser(lexer, type_keeper, arena);
   ast::Program* prg = parser.ParseProgram();
 
-  ast::SymbolTableBuilder gen;
+  passes::SymbolTableBuilder gen(arena, lexer.GetSources());
   prg->Accept(&gen);
 
-  ast::DefinitionChecker checker;
+  passes::DefinitionChecker checker(lexer.GetSources());
   CHECK_THROWS_AS(prg->Accept(&checker), ast::errors::UndefinedSymbolError);
 }
 
@@ -59,21 +66,23 @@ TEST_CASE("Symbol table: order-sensitive", "[symbol]") {
   std::stringstream program;
   program << "# Complete Lettuce program\n"
              "\n"
-             "var global_var = if 12 == 11 + 1 then 14 else 15 + 81;\n"
+             "of Int var global_var = if 12 == 11 + 1 then 14 else 15 + 81;\n"
              "\n"
-             "fun magic_calc(b, c) = {\n"
+             "of [Int, Int] -> Int fun magic_calc(b, c) = {\n"
              "    if (global_var == 14) then return a * b + c; a + b * c;\n"
-             "    var a = 14;\n"
+             "    of Int var a = 14;\n"
              "};";
 
   lex::Lexer lexer(program);
-  parse::Parser parser(lexer);
+  types::TypeContext type_keeper;
+  ast::Arena arena;
+  parse::Parser parser(lexer, type_keeper, arena);
   ast::Program* prg = parser.ParseProgram();
 
-  ast::SymbolTableBuilder gen;
+  passes::SymbolTableBuilder gen(arena, lexer.GetSources());
   prg->Accept(&gen);
 
-  ast::DefinitionChecker checker;
+  passes::DefinitionChecker checker(lexer.GetSources());
   CHECK_THROWS_AS(prg->Accept(&checker), ast::errors::UndefinedSymbolError);
 }
 
@@ -81,19 +90,274 @@ TEST_CASE("Symbol table: redefinition", "[symbol]") {
   std::stringstream program;
   program << "# Complete Lettuce program\n"
              "\n"
-             "var global_var = if 12 == 11 + 1 then 14 else 15 + 81;\n"
+             "of Int var global_var = if 12 == 11 + 1 then 14 else 15 + 81;\n"
              "\n"
-             "fun magic_calc(b, c) = {\n"
-             "    var a = 14;\n"
-             "    var a = global_var;\n"
+             "of [Int, Int] -> Int fun magic_calc(b, c) = {\n"
+             "    of Int var a = 14;\n"
+             "    of Int var a = global_var;\n"
              "    if (global_var == 14) then return a * b + c; a + b * c;\n"
              "};";
 
   lex::Lexer lexer(program);
-  parse::Parser parser(lexer);
+  types::TypeContext type_keeper;
+  ast::Arena arena;
+  parse::Parser parser(lexer, type_keeper, arena);
   ast::Program* prg = parser.ParseProgram();
 
-  ast::SymbolTableBuilder gen;
+  passes::SymbolTableBuilder gen(arena, lexer.GetSources());
   CHECK_THROWS_AS(prg->Accept(&gen), ast::errors::RedefinitionError);
 }
 
+TEST_CASE("Symbol table: deep nesting", "[symbol]") {
+  constexpr size_t kDepth = 100'000;
+
+  std::string program = "of [Int] -> Int fun f(x) = {\n    of Int var y = ";
+  for (size_t i = 0; i < kDepth; i++) {
+    program += fmt::format("if x == {} then {{ -x; }} else ", i);
+  }
+  program += "x;\n    ";
+  for (size_t i = 0; i < kDepth; i++) {
+    program += "{ ";
+  }
+  program += "y + x;";
+  for (size_t i = 0; i < kDepth; i++) {
+    program += " };";
+  }
+  program += "\n};";
+
+  lex::Lexer lexer(program);
+  types::TypeContext type_keeper;
+  ast::Arena arena;
+  parse::Parser parser(lexer, type_keeper, arena);
+  parser.SetIterative(true);
+  ast::Program* prg = parser.ParseProgram();
+
+  // None of the passes recurses per nesting level
+  passes::SymbolTableBuilder gen(arena, lexer.GetSources());
+  REQUIRE_NOTHROW(prg->Accept(&gen));
+
+  passes::DefinitionChecker checker(lexer.GetSources());
+  REQUIRE_NOTHROW(prg->Accept(&checker));
+
+  passes::TypeEvaluator type_evaluator(lexer.GetSources());
+  REQUIRE_NOTHROW(prg->Accept(&type_evaluator));
+}
+
+TEST_CASE("Symbol table: many globals", "[symbol]") {
+  constexpr size_t kGlobals = 20'000;
+
+  std::string program = "of Int var g0 = 0;\n";
+  for (size_t i = 1; i < kGlobals; i++) {
+    program += fmt::format("of Int var g{} = g{} + 1;\n", i, i - 1);
+  }
+  // The local is declared after the first use, which still sees the global
+  program += fmt::format("of [Int] -> Int fun f(x) = {{ g0 + g{}; of Int var g0 = x; g0; }};", kGlobals - 1);
+
+  lex::Lexer lexer(program);
+  types::TypeContext type_keeper;
+  ast::Arena arena;
+  parse::Parser parser(lexer, type_keeper, arena);
+  ast::Program* prg = parser.ParseProgram();
+
+  // Lookups do not scan the global scope
+  passes::SymbolTableBuilder gen(arena, lexer.GetSources());
+  REQUIRE_NOTHROW(prg->Accept(&gen));
+
+  passes::DefinitionChecker checker(lexer.GetSources());
+  REQUIRE_NOTHROW(prg->Accept(&checker));
+
+  passes::TypeEvaluator type_evaluator(lexer.GetSources());
+  REQUIRE_NOTHROW(prg->Accept(&type_evaluator));
+}
+
+TEST_CASE("Symbol table: bindings", "[symbol]") {
+  std::stringstream program;
+  program << "of Int var x = 1;\n"
+             "of [Int] -> Int fun f(x) = { x; };\n"
+             "of Int var y = x;";
+
+  lex::Lexer lexer(program);
+  types::TypeContext type_keeper;
+  ast::Arena arena;
+  parse::Parser parser(lexer, type_keeper, arena);
+  ast::Program* prg = parser.ParseProgram();
+
+  {
+    passes::SymbolTableBuilder gen(arena, lexer.GetSources());
+    prg->Accept(&gen);
+
+    passes::DefinitionChecker checker(lexer.GetSources());
+    prg->Accept(&checker);
+  }
+
+  auto* global = utils::cast<ast::VarDeclStatement>(prg->decls_[0]);
+  auto* fun = utils::cast<ast::FunDeclStatement>(prg->decls_[1]);
+  auto* body = utils::cast<ast::BlockExpression>(fun->GetBody());
+  auto* param_use = utils::cast<ast::LiteralExpression>(utils::cast<ast::ExprStatement>(body->statements_[0])->expr_);
+  auto* global_use = utils::cast<ast::LiteralExpression>(utils::cast<ast::VarDeclStatement>(prg->decls_[2])->init_expr_);
+
+  // The parameter shadows the global
+  REQUIRE(param_use->symbol != nullptr);
+  CHECK(param_use->symbol->location.abs_pos == fun->params_[0].GetLocation().abs_pos);
+  REQUIRE(global_use->symbol != nullptr);
+  CHECK(global_use->symbol->location.abs_pos == global->GetLocation().abs_pos);
+
+  // Scopes are gone, the bindings are enough
+  passes::TypeEvaluator type_evaluator(lexer.GetSources());
+  REQUIRE_NOTHROW(prg->Accept(&type_evaluator));
+  CHECK(global_use->type == &types::PrimitiveType::int_type);
+}
+
+TEST_CASE("Symbol table: call of an untyped callee", "[symbol]") {
+  // A yield has no type, calling it is a type error rather than a crash
+  std::string program =
+      "of [Int] -> Int fun f(x) = {\n"
+      "  of Int var y = (yield 1)(x);\n"
+      "  y;\n"
+      "};";
+
+  lex::Lexer lexer(program);
+  types::TypeContext type_keeper;
+  ast::Arena arena;
+  parse::Parser parser(lexer, type_keeper, arena);
+  ast::Program* prg = parser.ParseProgram();
+
+  passes::SymbolTableBuilder gen(arena, lexer.GetSources());
+  prg->Accept(&gen);
+  passes::DefinitionChecker checker(lexer.GetSources());
+  prg->Accept(&checker);
+
+  passes::TypeEvaluator type_evaluator(lexer.GetSources());
+  CHECK_THROWS_AS(prg->Accept(&type_evaluator), types::errors::FnCallNonFuncTypeError);
+}
+
+TEST_CASE("Symbol table: fused analysis", "[symbol]") {
+  // First error of the three passes, run one by one or in one walk
+  auto analyze = [](const std::string& program, bool fused) -> std::string {
+    lex::Lexer lexer(program);
+    types::TypeContext type_keeper;
+    ast::Arena arena;
+    parse::Parser parser(lexer, type_keeper, arena);
+    ast::Program* prg = parser.ParseProgram();
+
+    passes::SymbolTableBuilder gen(arena, lexer.GetSources());
+    passes::DefinitionChecker checker(lexer.GetSources());
+    passes::TypeEvaluator type_evaluator(lexer.GetSources());
+    try {
+      if (fused) {
+        ast::FusedVisitor analysis(gen, checker, type_evaluator);
+        prg->Accept(&analysis);
+      } else {
+        prg->Accept(&gen);
+        prg->Accept(&checker);
+        prg->Accept(&type_evaluator);
+      }
+    } catch (const errors::CompileError& error) {
+      return error.what();
+    }
+    return "ok";
+  };
+
+  std::vector<std::string> programs = {
+      // Globals may be used before they are declared
+      "of [] -> Int fun f() = { g + 1; };\n"
+      "of Int var g = 1;",
+      // A type error comes before an undefined symbol
+      "of Int var a = 1 + true;\n"
+      "of Int var b = c;",
+      // And before a redefinition
+      "of Int var a = 1 + true;\n"
+      "of [] -> Int fun f() = { of Int var x = 1; of Int var x = 2; x; };",
+      // A global redefinition after a local one
+      "of [] -> Int fun f() = { of Int var x = 1; of Int var x = 2; x; };\n"
+      "of Int var f = 3;",
+      // A redefinition nested in the initializer of another
+      "of [] -> Int fun f() = {\n"
+      "  of Int var x = 1;\n"
+      "  of Int var x = { of Int var y = 1; of Int var y = 2; y; };\n"
+      "  x;\n"
+      "};",
+      // A local used before its declaration is looked up outside
+      "of Bool var x = true;\n"
+      "of [] -> Bool fun f() = { x; of Int var x = 1; x == 1; };",
+      // A local in its own initializer
+      "of Bool var x = true;\n"
+      "of [] -> Int fun f() = { of Int var x = x + 1; x; };",
+      // A call of a function declared later
+      "of [] -> Int fun f() = { g(2); };\n"
+      "of [Int] -> Int fun g(a) = { a * 2; };",
+  };
+
+  std::vector<std::string> results;
+  for (const std::string& program : programs) {
+    results.push_back(analyze(program, /*fused=*/false));
+    CHECK(analyze(program, /*fused=*/true) == results.back());
+  }
+
+  CHECK(results[0] == "ok");
+  CHECK(results[1].starts_with("Use of undefined symbol c"));
+  CHECK(results[2].starts_with("Redefinition of symbol x"));
+  CHECK(results[3].starts_with("Redefinition of symbol x"));
+  CHECK(results[4].starts_with("Redefinition of symbol y"));
+  CHECK(results[5] == "ok");
+  CHECK(results[6] == "ok");
+  CHECK(results[7] == "ok");
+}
+
+TEST_CASE("Symbol table: parallel analysis", "[symbol]") {
+  // Errors in three declarations: a type error, an undefined symbol and
+  // another type error, spread over several batches
+  std::string program = "of Int var g = 1;\n";
+  for (size_t i = 1; i < 300; i++) {
+    if (i == 70 || i == 280) {
+      program += fmt::format("of [Int] -> Int fun f{}(x) = {{ x + true; }};\n", i);
+    } else if (i == 200) {
+      program += fmt::format("of [Int] -> Int fun f{}(x) = {{ x + h; }};\n", i);
+    } else {
+      program += fmt::format("of [Int] -> Int fun f{}(x) = {{ of Int var y = x * g; f{}(y); }};\n",
+                             i, 300 - i);
+    }
+  }
+
+  types::TypeContext type_keeper;
+  auto parse = [&](lex::Lexer& lexer, ast::Arena& arena) {
+    parse::Parser parser(lexer, type_keeper, arena);
+    return parser.ParseProgram();
+  };
+
+  lex::Lexer serial_lexer(program);
+  ast::Arena serial_arena;
+  ast::Program* serial = parse(serial_lexer, serial_arena);
+  passes::SymbolTableBuilder gen(serial_arena, serial_lexer.GetSources());
+  passes::DefinitionChecker checker(serial_lexer.GetSources());
+  passes::TypeEvaluator type_evaluator(serial_lexer.GetSources());
+  ast::FusedVisitor analysis(gen, checker, type_evaluator);
+
+  std::string expected;
+  try {
+    serial->Accept(&analysis);
+  } catch (const errors::CompileError& error) {
+    expected = error.what();
+  }
+  CHECK(expected.starts_with("Use of undefined symbol h"));
+
+  lex::Lexer lexer(program);
+  ast::Arena arena;
+  ast::Program* prg = parse(lexer, arena);
+  utils::ThreadPool pool(4);
+  passes::ParallelAnalyzer analyzer(arena, lexer.GetSources(), pool);
+  CHECK_THROWS_WITH(analyzer.Analyze(prg), expected);
+
+  // One error per failed declaration, in declaration order
+  auto& errors = analyzer.GetErrors();
+  REQUIRE(errors.size() == 3);
+  CHECK(errors[0].decl == 70);
+  CHECK(errors[1].decl == 200);
+  CHECK(errors[2].decl == 280);
+  CHECK(errors[1].pass < errors[0].pass);
+
+  // The rest is fully typed, locals and calls included
+  auto* fun = utils::cast<ast::FunDeclStatement>(prg->decls_[150]);
+  auto* body = utils::cast<ast::BlockExpression>(fun->GetBody());
+  CHECK(body->type == &types::PrimitiveType::int_type);
+}